@@ -0,0 +1,35 @@
+/**
+ * @file main.cpp
+ * @brief Batch driver: focuses every stack of a manifest in one process
+ * 
+ * Where the six programs focus one stack per launch, this one reads a
+ * manifest of jobs (see FocusBatch.h) and runs them through a pipeline that
+ * loads, focuses and writes three stacks at once, on one persistent pool of
+ * threads.  It has no GUI.
+ * 
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <vector>
+#include "FocusBatch.h"
+
+/**
+ * @brief Main function of the application.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return Exit status: 0 if every job was written, 20 if some failed.
+ */
+int main(int argc, char** argv)
+{
+    BatchOptions options;
+    if (!parseBatchOptions(argc, argv, options))
+        return 1;
+
+    std::vector<BatchJob> jobs;
+    if (!readBatchManifest(options, jobs))
+        return 1;
+
+    unsigned int numFailed = runBatch(options, jobs);
+    return (numFailed == 0) ? 0 : 20;
+}
@@ -0,0 +1,286 @@
+/**
+ * @file Checkpoint.cpp
+ * @brief Periodic checkpoints of the output, written in the background, and resuming from them
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "Checkpoint.h"
+#include "FocusEngine.h"
+#include "FocusMapCache.h"
+#include "FocusStats.h"
+#include "ImageIO.h"
+
+/** @brief How often the writer checks the coverage, in milliseconds. */
+static const unsigned int CHECKPOINT_POLL_MS = 100;
+
+/** @brief First bytes of a coverage file (the last one is the version of the format). */
+static const char COVERAGE_MAGIC[8] = {'F', 'O', 'C', 'U', 'S', 'C', 'V', '2'};
+
+/**
+ * @struct CoverageHeader
+ * @brief What the pixels of a checkpoint were computed from (after the magic of its coverage file).
+ */
+struct CoverageHeader {
+	uint32_t width;
+	uint32_t height;
+	uint32_t windowSize;
+	uint32_t blend;
+	uint64_t stackHash;
+};
+
+/**
+ * @brief Hashes the pixels of the layers of a stack, in order
+ * @param ctx Context of the run
+ * @return The hash
+ */
+static uint64_t hashStack(const FocusContext* ctx) {
+	uint64_t hash = ctx->imageStack.size();
+	for (const RasterImage* layer : ctx->imageStack)
+		hash = hashImagePixels(layer, hash);
+	return hash;
+}
+
+/**
+ * @brief Header of the coverage file of a run
+ * @param ctx Context of the run
+ * @param stackHash Hash of its stack (see hashStack)
+ * @return The header
+ */
+static CoverageHeader coverageHeader(const FocusContext* ctx, uint64_t stackHash) {
+	CoverageHeader header = {ctx->imageOut->width, ctx->imageOut->height, (uint32_t) ctx->windowSize,
+							 ctx->options.blend ? 1u : 0u, stackHash};
+	return header;
+}
+
+/**
+ * @brief Path of the image of the checkpoint of an output
+ * @param outputPath Path of the output
+ * @return e.g. "result.checkpoint.tga" for "result.tga"
+ */
+static std::string checkpointImagePath(const std::string& outputPath) {
+	return pathWithSuffix(outputPath, ".checkpoint");
+}
+
+/**
+ * @brief Path of the coverage file of the checkpoint of an output
+ * @param outputPath Path of the output
+ * @return e.g. "result.checkpoint.coverage" for "result.tga"
+ */
+static std::string checkpointCoveragePath(const std::string& outputPath) {
+	std::string imagePath = checkpointImagePath(outputPath);
+	return imagePath.substr(0, imagePath.rfind(".checkpoint")) + ".checkpoint.coverage";
+}
+
+/**
+ * @brief Start of a row of an image (its rows may not be in order in memory, see RasterImage)
+ * @param image The image
+ * @param row Index of the row
+ * @return Pointer to the first byte of the row
+ */
+static unsigned char* rasterRow(const RasterImage* image, unsigned int row) {
+	switch (image->type) {
+		case DEEP_GRAY_RASTER:
+			return (unsigned char*) ((unsigned short**) image->raster2D)[row];
+		case FLOAT_RASTER:
+			return (unsigned char*) ((float**) image->raster2D)[row];
+		default:
+			return ((unsigned char**) image->raster2D)[row];
+	}
+}
+
+/**
+ * @brief Writes a coverage bitmap (magic, header, then the words, in host order), atomically
+ * @param filePath Path to the file to write
+ * @param header What the pixels were computed from
+ * @param bits The bitmap
+ * @return false if the file couldn't be written
+ */
+static bool writeCoverage(const std::string& filePath, const CoverageHeader& header, const std::vector<uint64_t>& bits) {
+	std::string tempPath = filePath + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == NULL)
+		return false;
+	bool written = fwrite(COVERAGE_MAGIC, 1, sizeof(COVERAGE_MAGIC), file) == sizeof(COVERAGE_MAGIC) &&
+				   fwrite(&header, sizeof(header), 1, file) == 1 &&
+				   fwrite(bits.data(), sizeof(uint64_t), bits.size(), file) == bits.size();
+	written = (fclose(file) == 0) && written;
+	if (!written || rename(tempPath.c_str(), filePath.c_str()) != 0) {
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+CheckpointWriter::CheckpointWriter(const FocusContext* theContext)
+		:	ctx(theContext),
+			snapshot(new RasterImage(theContext->imageOut->width, theContext->imageOut->height, theContext->imageOut->type)),
+			stackHash(0),
+			stopping(false),
+			outputWritten(false)
+{
+	snapshot->maxVal = ctx->imageOut->maxVal;
+}
+
+CheckpointWriter::~CheckpointWriter(void) {
+	if (thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		thread.join();
+	}
+	delete snapshot;
+}
+
+void CheckpointWriter::start(void) {
+	thread = std::thread(&CheckpointWriter::run, this);
+}
+
+void CheckpointWriter::run(void) {
+	//	(here rather than in the constructor: the threads don't wait for it)
+	stackHash = hashStack(ctx);
+	const FocusOptions& options = ctx->options;
+	const uint64_t periodNs = (uint64_t) options.checkpointPeriodS * 1000000000ull;
+	const double step = options.checkpointCoveragePercent / 100.0;
+	uint64_t lastTime = statsNow();
+	double lastMilestone = (step > 0.0) ? std::floor(ctx->coverage->fractionCovered() / step) : 0.0;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopping) {
+		wakeUp.wait_for(lock, std::chrono::milliseconds(CHECKPOINT_POLL_MS));
+		if (stopping)
+			break;
+		lock.unlock();
+
+		//	Done: all covered, and every thread of this run finished
+		if (ctx->coverage->isComplete() &&
+			ctx->numFinishedThreads.load(std::memory_order_acquire) == ctx->options.numThreads) {
+			writeFinalOutput();
+			lock.lock();
+			break;
+		}
+		double milestone = (step > 0.0) ? std::floor(ctx->coverage->fractionCovered() / step) : 0.0;
+		if ((periodNs > 0 && statsNow() - lastTime >= periodNs) || milestone > lastMilestone) {
+			writeCheckpoint();
+			lastTime = statsNow();
+			lastMilestone = milestone;
+		}
+		lock.lock();
+	}
+}
+
+void CheckpointWriter::writeCheckpoint(void) {
+	//	The coverage first: every pixel it marks is then in the copy of the image
+	double fractionCovered = ctx->coverage->fractionCovered();
+	std::vector<uint64_t> bits = ctx->coverage->copyBits();
+	memcpy(snapshot->raster, ctx->imageOut->raster, (size_t) ctx->imageOut->bytesPerRow * ctx->imageOut->height);
+
+	const std::string& outputPath = ctx->options.outputPath;
+	std::string imagePath = checkpointImagePath(outputPath);
+	if (writeImageAtomically(imagePath.c_str(), snapshot, ctx->options.compressOutput) != kNoIOerror ||
+		!writeCoverage(checkpointCoveragePath(outputPath), coverageHeader(ctx, stackHash), bits)) {
+		fprintf(stderr, "Could not write the checkpoint of %s\n", outputPath.c_str());
+		return;
+	}
+	fprintf(stderr, "Checkpoint: %.1f%% covered, in %s\n", 100.0 * fractionCovered, imagePath.c_str());
+}
+
+void CheckpointWriter::writeFinalOutput(void) {
+	const std::string& outputPath = ctx->options.outputPath;
+	if (writeImageAtomically(outputPath.c_str(), ctx->imageOut, ctx->options.compressOutput) != kNoIOerror)
+		return;
+	//	(with any temporary file a killed run left behind)
+	std::string imagePath = checkpointImagePath(outputPath);
+	std::string coveragePath = checkpointCoveragePath(outputPath);
+	for (const std::string& path : {imagePath, pathWithSuffix(imagePath, ".tmp"), coveragePath, coveragePath + ".tmp"})
+		remove(path.c_str());
+	outputWritten = true;
+}
+
+void CheckpointWriter::finish(void) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	if (thread.joinable())
+		thread.join();
+
+	if (outputWritten)
+		return;
+	if (ctx->coverage->isComplete())
+		writeFinalOutput();
+	else {
+		writeImageAtomically(ctx->options.outputPath.c_str(), ctx->imageOut, ctx->options.compressOutput);
+		writeCheckpoint();
+		fprintf(stderr, "Run with --resume to finish %s\n", ctx->options.outputPath.c_str());
+	}
+}
+
+bool resumeFromCheckpoint(FocusContext* ctx) {
+	const std::string& outputPath = ctx->options.outputPath;
+	std::string imagePath = checkpointImagePath(outputPath);
+	std::string coveragePath = checkpointCoveragePath(outputPath);
+	if (access(imagePath.c_str(), R_OK) != 0 || access(coveragePath.c_str(), R_OK) != 0) {
+		fprintf(stderr, "No checkpoint of %s: starting from scratch\n", outputPath.c_str());
+		return false;
+	}
+
+	//	The coverage file must be for the same computation: same size, window
+	//	and blending, on the same stack
+	RasterImage* imageOut = ctx->imageOut;
+	std::vector<uint64_t> bits = ctx->coverage->copyBits();
+	CoverageHeader expected = coverageHeader(ctx, hashStack(ctx));
+	FILE* file = fopen(coveragePath.c_str(), "rb");
+	char magic[sizeof(COVERAGE_MAGIC)] = {0};
+	CoverageHeader header;
+	bool valid = file != NULL &&
+				 fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+				 memcmp(magic, COVERAGE_MAGIC, sizeof(magic)) == 0 &&
+				 fread(&header, sizeof(header), 1, file) == 1 &&
+				 fread(bits.data(), sizeof(uint64_t), bits.size(), file) == bits.size();
+	if (file != NULL)
+		fclose(file);
+	const char* mismatch = !valid ? "its coverage file is not valid"
+						 : (header.width != expected.width || header.height != expected.height) ? "it is of another size"
+						 : (header.windowSize != expected.windowSize) ? "it was computed with another window size"
+						 : (header.blend != expected.blend) ? (header.blend ? "it was computed with --blend" : "it was computed without --blend")
+						 : (header.stackHash != expected.stackHash) ? "it was computed from another stack"
+						 : nullptr;
+
+	RasterImage* saved = (mismatch == nullptr) ? readImage(imagePath.c_str()) : nullptr;
+	if (mismatch == nullptr && (saved->width != imageOut->width || saved->height != imageOut->height ||
+								saved->type != imageOut->type))
+		mismatch = "its image doesn't match the stack";
+	if (mismatch != nullptr) {
+		fprintf(stderr, "The checkpoint of %s doesn't match this run: %s (remove %s and %s to start over)\n",
+				outputPath.c_str(), mismatch, imagePath.c_str(), coveragePath.c_str());
+		exit(18);
+	}
+	//	Row by row: a saved PGM is a view of the file, top row first
+	for (unsigned int row = 0; row < imageOut->height; row++)
+		memcpy(rasterRow(imageOut, row), rasterRow(saved, row), imageOut->bytesPerRow);
+	delete saved;
+	statsPixelsRestored(ctx->coverage->restoreBits(bits));
+
+	//	So the display copy shows the restored pixels (the front end redraws
+	//	the image once the restored pixels are counted)
+	if (ctx->displaySnapshot != nullptr) {
+		ctx->displaySnapshot->beginWrite(0, imageOut->height - 1, 0, imageOut->width - 1);
+		ctx->displaySnapshot->endWrite(0, imageOut->height - 1, 0, imageOut->width - 1);
+	}
+	fprintf(stderr, "Resuming %s from its checkpoint (%.1f%% covered)\n", outputPath.c_str(),
+			100.0 * ctx->coverage->fractionCovered());
+	return true;
+}
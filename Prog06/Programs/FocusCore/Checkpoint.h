@@ -0,0 +1,107 @@
+/**
+ * @file Checkpoint.h
+ * @brief Periodic checkpoints of the output, written in the background, and resuming from them
+ *
+ * With --checkpoint=<s> (every s seconds) and/or --checkpoint-coverage=<p>
+ * (each time another p% of the pixels is covered), a writer thread copies the
+ * coverage map, then the output image, and writes them next to the output,
+ * as <output>.checkpoint.<ext> and <output>.checkpoint.coverage (e.g.
+ * result.checkpoint.tga and result.checkpoint.coverage for result.tga).
+ * The coverage file also records what the pixels were computed from: the
+ * window size, --blend, and a hash of the pixels of the stack.
+ * Each file goes through
+ * a temporary file renamed over the previous one, and the image is renamed
+ * first, so a kill at any moment leaves an image holding at least every
+ * pixel the coverage file marks.  The focusing threads never wait for the
+ * writer.
+ *
+ * Once every thread of the run is done (a count held by its context), the
+ * writer writes the output itself and removes
+ * the checkpoint, so quitting the GUI doesn't stall on the write.  With
+ * --resume, a run starts from the checkpoint of its output: the saved pixels
+ * are copied to the output image and marked covered, and the workers skip
+ * them.  A checkpoint of another computation (another stack, window size or
+ * --blend) is refused, rather than mixed into the output.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "RasterImage.h"
+
+struct FocusContext;
+
+/**
+ * @class CheckpointWriter
+ * @brief Background thread that writes the checkpoints and the output of a run.
+ */
+class CheckpointWriter {
+public:
+	/**
+	 * @brief Creates the writer (the thread starts with start)
+	 * @param ctx Context of the run (its output image must be allocated)
+	 */
+	CheckpointWriter(const FocusContext* ctx);
+
+	CheckpointWriter(const CheckpointWriter&) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+	~CheckpointWriter(void);
+
+	/** @brief Starts the writer thread. */
+	void start(void);
+
+	/**
+	 * @brief Stops the writer thread, then makes sure the output is written
+	 *
+	 * If the run is complete, writes the output (unless the writer already
+	 * did) and removes the checkpoint; otherwise writes the partial output and
+	 * a last checkpoint to resume from.
+	 */
+	void finish(void);
+
+private:
+	/** @brief Body of the writer thread. */
+	void run(void);
+
+	/** @brief Copies the coverage map, then the output image, and writes them as the checkpoint. */
+	void writeCheckpoint(void);
+
+	/** @brief Writes the complete output and removes the checkpoint. */
+	void writeFinalOutput(void);
+
+	const FocusContext* ctx;
+
+	/** @brief Copy of the output image being written as a checkpoint. */
+	RasterImage* snapshot;
+
+	/** @brief Hash of the pixels of the stack (computed by the writer thread, before its first checkpoint). */
+	uint64_t stackHash;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	bool stopping;
+
+	/** @brief Set once the complete output has been written. */
+	bool outputWritten;
+};
+
+/**
+ * @brief Restores the checkpoint of the output of a run (--resume)
+ *
+ * Exits (18) if the checkpoint doesn't match the run: another size, window
+ * size or --blend, or another stack.
+ * @param ctx Context of the run (its output image and coverage map must be allocated)
+ * @return false if the output has no checkpoint (the run starts from scratch)
+ */
+bool resumeFromCheckpoint(FocusContext* ctx);
+
+#endif // CHECKPOINT_H
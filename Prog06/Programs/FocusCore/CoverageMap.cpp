@@ -0,0 +1,194 @@
+/**
+ * @file CoverageMap.cpp
+ * @brief Shared record of which output pixels have been written
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include "CoverageMap.h"
+
+CoverageMap::CoverageMap(unsigned int theWidth, unsigned int theHeight, unsigned int theTileSize)
+		:	width(theWidth),
+			height(theHeight),
+			tileSize(theTileSize),
+			tilesX((theWidth + theTileSize - 1) / theTileSize),
+			tilesY((theHeight + theTileSize - 1) / theTileSize),
+			wordsPerRow((theWidth + 63) / 64),
+			bits(static_cast<size_t>(wordsPerRow) * theHeight),
+			numCovered(0)
+{
+	for (auto& word : bits)
+		word.store(0, std::memory_order_relaxed);
+}
+
+void CoverageMap::markCovered(unsigned int rowMin, unsigned int rowMax, unsigned int colMin, unsigned int colMax) {
+	unsigned int firstWord = colMin / 64, lastWord = colMax / 64;
+	uint64_t newlyCovered = 0;
+
+	for (unsigned int row = rowMin; row <= rowMax; row++) {
+		std::atomic<uint64_t>* rowBits = bits.data() + static_cast<size_t>(row) * wordsPerRow;
+		for (unsigned int w = firstWord; w <= lastWord; w++) {
+			unsigned int lo = (w == firstWord) ? colMin % 64 : 0;
+			unsigned int hi = (w == lastWord) ? colMax % 64 : 63;
+			uint64_t mask = (hi == 63 ? ~0ULL : ((1ULL << (hi + 1)) - 1)) & ~((1ULL << lo) - 1);
+			uint64_t previous = rowBits[w].fetch_or(mask, std::memory_order_release);
+			newlyCovered += __builtin_popcountll(mask & ~previous);
+		}
+	}
+	if (newlyCovered > 0)
+		numCovered.fetch_add(newlyCovered, std::memory_order_relaxed);
+}
+
+bool CoverageMap::isCovered(unsigned int row, unsigned int col) const {
+	uint64_t word = bits[static_cast<size_t>(row) * wordsPerRow + col / 64].load(std::memory_order_relaxed);
+	return (word >> (col % 64)) & 1;
+}
+
+bool CoverageMap::isTileCovered(unsigned int tileIndex) const {
+	int rowMin, rowMax, colMin, colMax;
+	tileBounds(tileIndex, rowMin, rowMax, colMin, colMax);
+
+	for (int row = rowMin; row <= rowMax; row++)
+		for (int col = colMin; col <= colMax; col++)
+			if (!isCovered(row, col))
+				return false;
+	return true;
+}
+
+double CoverageMap::fractionCovered(void) const {
+	return static_cast<double>(numCovered.load(std::memory_order_relaxed)) /
+			(static_cast<double>(width) * height);
+}
+
+bool CoverageMap::isComplete(void) const {
+	return numCovered.load(std::memory_order_relaxed) == static_cast<uint64_t>(width) * height;
+}
+
+bool CoverageMap::isRowCovered(unsigned int row) const {
+	const std::atomic<uint64_t>* rowBits = bits.data() + static_cast<size_t>(row) * wordsPerRow;
+	for (unsigned int w = 0; w < wordsPerRow; w++) {
+		unsigned int numCols = std::min(width - 64 * w, 64U);
+		uint64_t mask = (numCols == 64) ? ~0ULL : (1ULL << numCols) - 1;
+		if ((rowBits[w].load(std::memory_order_relaxed) & mask) != mask)
+			return false;
+	}
+	return true;
+}
+
+std::vector<uint64_t> CoverageMap::copyBits(void) const {
+	std::vector<uint64_t> copy(bits.size());
+	for (size_t k = 0; k < bits.size(); k++)
+		copy[k] = bits[k].load(std::memory_order_acquire);
+	return copy;
+}
+
+uint64_t CoverageMap::restoreBits(const std::vector<uint64_t>& savedBits) {
+	uint64_t newlyCovered = 0;
+	for (size_t k = 0; k < bits.size() && k < savedBits.size(); k++) {
+		//	(ignoring any bit past the end of a row)
+		unsigned int numCols = std::min(width - 64 * static_cast<unsigned int>(k % wordsPerRow), 64U);
+		uint64_t word = savedBits[k] & ((numCols == 64) ? ~0ULL : (1ULL << numCols) - 1);
+		uint64_t previous = bits[k].fetch_or(word, std::memory_order_release);
+		newlyCovered += __builtin_popcountll(word & ~previous);
+	}
+	numCovered.fetch_add(newlyCovered, std::memory_order_relaxed);
+	return newlyCovered;
+}
+
+std::vector<unsigned int> CoverageMap::tileOrder(bool progressive) const {
+	std::vector<unsigned int> order;
+	order.reserve(tilesX * tilesY);
+	if (!progressive) {
+		for (unsigned int t = 0; t < tilesX * tilesY; t++)
+			order.push_back(t);
+		return order;
+	}
+
+	//	The Bayer index of cell (x, y) in a 2^n x 2^n grid is the bit reversal
+	//	of the interleaved bits of (x ^ y) and y.  Tiles outside the actual
+	//	grid are simply skipped by sorting on the key.
+	unsigned int numBits = 0;
+	while ((1U << numBits) < std::max(tilesX, tilesY))
+		numBits++;
+
+	std::vector<std::pair<uint64_t, unsigned int>> keyed;
+	keyed.reserve(tilesX * tilesY);
+	for (unsigned int ty = 0; ty < tilesY; ty++) {
+		for (unsigned int tx = 0; tx < tilesX; tx++) {
+			unsigned int u = tx ^ ty;
+			uint64_t key = 0;
+			for (unsigned int b = 0; b < numBits; b++) {
+				//	interleave from the least significant bit, writing the
+				//	result from the most significant end (bit reversal)
+				key |= static_cast<uint64_t>((u >> b) & 1) << (2 * (numBits - b) - 1);
+				key |= static_cast<uint64_t>((ty >> b) & 1) << (2 * (numBits - b) - 2);
+			}
+			keyed.emplace_back(key, ty * tilesX + tx);
+		}
+	}
+	std::sort(keyed.begin(), keyed.end());
+
+	for (const auto& k : keyed)
+		order.push_back(k.second);
+	return order;
+}
+
+std::vector<unsigned int> CoverageMap::tilesInRows(const std::vector<unsigned int>& order, unsigned int startRow, unsigned int endRow) const {
+	std::vector<unsigned int> tiles;
+	for (unsigned int t : order) {
+		int centerRow, centerCol;
+		tileCenter(t, centerRow, centerCol);
+		if (static_cast<unsigned int>(centerRow) >= startRow && static_cast<unsigned int>(centerRow) < endRow)
+			tiles.push_back(t);
+	}
+	return tiles;
+}
+
+std::vector<unsigned int> CoverageMap::tilesInSlice(const std::vector<unsigned int>& order, unsigned int sliceIndex, unsigned int numSlices) const {
+	std::vector<unsigned int> tiles;
+	for (size_t k = sliceIndex; k < order.size(); k += numSlices)
+		tiles.push_back(order[k]);
+	return tiles;
+}
+
+void CoverageMap::tileCenter(unsigned int tileIndex, int& centerRow, int& centerCol) const {
+	centerRow = std::min((tileIndex / tilesX) * tileSize + tileSize / 2, height - 1);
+	centerCol = std::min((tileIndex % tilesX) * tileSize + tileSize / 2, width - 1);
+}
+
+void CoverageMap::tileBounds(unsigned int tileIndex, int& rowMin, int& rowMax, int& colMin, int& colMax) const {
+	rowMin = (tileIndex / tilesX) * tileSize;
+	colMin = (tileIndex % tilesX) * tileSize;
+	rowMax = std::min(rowMin + tileSize, height) - 1;
+	colMax = std::min(colMin + tileSize, width) - 1;
+}
+
+TileSampler::TileSampler(const CoverageMap* theCoverage, std::vector<unsigned int> theTiles, bool theInOrder)
+		:	coverage(theCoverage),
+			tiles(std::move(theTiles)),
+			inOrder(theInOrder)
+{
+	//	in order mode we pop from the back
+	if (inOrder)
+		std::reverse(tiles.begin(), tiles.end());
+}
+
+bool TileSampler::nextWindow(FastRandom& generator, unsigned int& tileIndex, int& centerRow, int& centerCol) {
+	while (!tiles.empty()) {
+		size_t k = tiles.size() - 1;
+		if (!inOrder)
+			k = generator.below(static_cast<uint32_t>(tiles.size()));
+		tileIndex = tiles[k];
+		tiles[k] = tiles.back();
+		tiles.pop_back();
+
+		//	(a tile restored from a checkpoint is already covered)
+		if (!coverage->isTileCovered(tileIndex)) {
+			coverage->tileCenter(tileIndex, centerRow, centerCol);
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file CoverageMap.h
+ * @brief Shared record of which output pixels have been written
+ *
+ * The coverage map keeps one bit per output pixel (atomic 64-bit words, so
+ * any thread may mark pixels without a lock) and splits the image into
+ * square tiles the size of the focusing window.  Random-window threads draw
+ * from a shrinking list of their own uncovered tiles instead of sampling
+ * window centers uniformly forever, so a run completes in one window per
+ * tile rather than in coupon-collector time.
+ *
+ * Tiles can also be handed out in a progressive (low-discrepancy) order, so
+ * that the partial output is refined uniformly over the whole image at any
+ * moment instead of filling in random clusters.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef COVERAGE_MAP_H
+#define COVERAGE_MAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "FastRandom.h"
+
+/**
+ * @class CoverageMap
+ * @brief Atomic one-bit-per-pixel coverage of the output image, plus its tiling.
+ */
+class CoverageMap {
+public:
+	/**
+	 * @brief Creates an empty (nothing covered) map.
+	 * @param width Width of the output image
+	 * @param height Height of the output image
+	 * @param tileSize Side of the square tiles (the focusing window size)
+	 */
+	CoverageMap(unsigned int width, unsigned int height, unsigned int tileSize);
+
+	CoverageMap(const CoverageMap&) = delete;
+	CoverageMap& operator=(const CoverageMap&) = delete;
+
+	/**
+	 * @brief Marks a rectangle of pixels as covered (bounds are inclusive and
+	 *	must already be clipped to the image).
+	 */
+	void markCovered(unsigned int rowMin, unsigned int rowMax, unsigned int colMin, unsigned int colMax);
+
+	/** @brief Returns true if the pixel at (row, col) has been covered. */
+	bool isCovered(unsigned int row, unsigned int col) const;
+
+	/** @brief Returns true if every pixel of the tile has been covered. */
+	bool isTileCovered(unsigned int tileIndex) const;
+
+	/** @brief Fraction (0 to 1) of the pixels covered so far. */
+	double fractionCovered(void) const;
+
+	/** @brief Returns true once every pixel has been covered. */
+	bool isComplete(void) const;
+
+	/** @brief Returns true if every pixel of the row has been covered. */
+	bool isRowCovered(unsigned int row) const;
+
+	/**
+	 * @brief Copies the bitmap (rows of (width + 63) / 64 words).  The pixels it
+	 *	marks were written before the copy was made (markCovered releases, the
+	 *	copy acquires), so a copy of the image made after it holds them.
+	 */
+	std::vector<uint64_t> copyBits(void) const;
+
+	/**
+	 * @brief Marks as covered the pixels set in a bitmap made by copyBits
+	 *	(e.g. one saved in a checkpoint).
+	 * @return Number of pixels newly covered
+	 */
+	uint64_t restoreBits(const std::vector<uint64_t>& savedBits);
+
+	/**
+	 * @brief Lists all the tiles, in scan order or in progressive order: the
+	 *	ordered-dither (Bayer) sequence, a base-2 low-discrepancy ordering of the
+	 *	tile grid in which every prefix is spread evenly over the image.  Sorting
+	 *	the grid takes O(T log T), so it is listed once and shared by the threads.
+	 * @param progressive If true, the tiles are listed in progressive order
+	 */
+	std::vector<unsigned int> tileOrder(bool progressive) const;
+
+	/**
+	 * @brief Lists the tiles of an order (see tileOrder) whose center row lies
+	 *	in [startRow, endRow).  Used to hand each row band its own tiles.
+	 */
+	std::vector<unsigned int> tilesInRows(const std::vector<unsigned int>& order, unsigned int startRow, unsigned int endRow) const;
+
+	/**
+	 * @brief Lists every numSlices-th tile of an order (see tileOrder), starting
+	 *	at its tile sliceIndex.  Used to split the whole image between threads
+	 *	without overlap: in progressive order, each thread gets an interleaved
+	 *	slice of the same sequence.
+	 */
+	std::vector<unsigned int> tilesInSlice(const std::vector<unsigned int>& order, unsigned int sliceIndex, unsigned int numSlices) const;
+
+	/**
+	 * @brief Computes the window centered on a tile.  A window of size tileSize
+	 *	centered there covers the whole tile (the center of a partial tile at the
+	 *	right or bottom edge is moved inside the image, so that window also
+	 *	reaches into its neighbours: see tileBounds).
+	 */
+	void tileCenter(unsigned int tileIndex, int& centerRow, int& centerCol) const;
+
+	/**
+	 * @brief Computes the pixels of a tile (bounds are inclusive).  Writing only
+	 *	those keeps every pixel owned by the thread that owns its tile, so the
+	 *	output doesn't depend on the order in which the threads run.
+	 */
+	void tileBounds(unsigned int tileIndex, int& rowMin, int& rowMax, int& colMin, int& colMax) const;
+
+	/** @brief Width of the image covered. */
+	unsigned int width;
+
+	/** @brief Height of the image covered. */
+	unsigned int height;
+
+	/** @brief Side of the square tiles. */
+	unsigned int tileSize;
+
+	/** @brief Number of tile columns. */
+	unsigned int tilesX;
+
+	/** @brief Number of tile rows. */
+	unsigned int tilesY;
+
+private:
+	/** @brief Number of 64-bit words per row of the bitmap. */
+	unsigned int wordsPerRow;
+
+	/** @brief The bitmap, one bit per pixel, rows of wordsPerRow words. */
+	std::vector<std::atomic<uint64_t>> bits;
+
+	/** @brief Number of distinct pixels covered so far. */
+	std::atomic<uint64_t> numCovered;
+};
+
+/**
+ * @class TileSampler
+ * @brief A thread's own shrinking list of uncovered tiles.
+ *
+ * Not shared: each thread owns one, built from a disjoint set of tiles, so
+ * drawing from it never needs a lock.
+ */
+class TileSampler {
+public:
+	/**
+	 * @brief Creates the sampler.
+	 * @param coverage The shared coverage map
+	 * @param tiles Indices of the tiles this thread is responsible for
+	 * @param inOrder If true, the tiles are drawn in list order rather than at random
+	 */
+	TileSampler(const CoverageMap* coverage, std::vector<unsigned int> tiles, bool inOrder = false);
+
+	/**
+	 * @brief Draws the next uncovered tile (at random, or in list order) and
+	 *	removes it from the list.
+	 * @param generator Random engine of the calling thread
+	 * @param tileIndex Receives the index of the tile
+	 * @param centerRow Receives the row of the window center
+	 * @param centerCol Receives the column of the window center
+	 * @return false once all of the thread's tiles are covered
+	 */
+	bool nextWindow(FastRandom& generator, unsigned int& tileIndex, int& centerRow, int& centerCol);
+
+	/** @brief Number of tiles still to draw. */
+	size_t remaining(void) const { return tiles.size(); }
+
+private:
+	const CoverageMap* coverage;
+	/** @brief Tiles still to draw.  In order mode, stored reversed (next at the back). */
+	std::vector<unsigned int> tiles;
+	bool inOrder;
+};
+
+#endif	//	COVERAGE_MAP_H
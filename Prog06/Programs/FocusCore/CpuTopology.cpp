@@ -0,0 +1,141 @@
+/**
+ * @file CpuTopology.cpp
+ * @brief NUMA topology, thread pinning and placement of memory on a node
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "CpuTopology.h"
+
+/** @brief mbind mode: allocate on the node, or elsewhere if it is full (from numaif.h). */
+static const int MPOL_PREFERRED_MODE = 1;
+
+/** @brief mbind flag: move the pages already allocated (from numaif.h). */
+static const unsigned int MPOL_MF_MOVE_FLAG = 1u << 1;
+
+/**
+ * @brief Parses a sysfs CPU list, e.g. "0-3,8-11"
+ * @param text The list
+ * @return The CPUs of the list
+ */
+static std::vector<int> parseCpuList(const char* text) {
+	std::vector<int> cpus;
+	while (*text != '\0' && *text != '\n') {
+		char* end;
+		int first = (int) strtol(text, &end, 10);
+		int last = first;
+		if (end == text)
+			break;
+		if (*end == '-')
+			last = (int) strtol(end + 1, &end, 10);
+		for (int cpu = first; cpu <= last; cpu++)
+			cpus.push_back(cpu);
+		text = (*end == ',') ? end + 1 : end;
+	}
+	return cpus;
+}
+
+CpuTopology readCpuTopology(void) {
+	CpuTopology topology;
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		for (long cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN) && cpu < CPU_SETSIZE; cpu++)
+			CPU_SET(cpu, &allowed);
+	}
+
+	//	One entry per nodeN directory, keeping only the CPUs we may run on
+	DIR* nodeDir = opendir("/sys/devices/system/node");
+	if (nodeDir != NULL) {
+		std::vector<std::pair<int, std::vector<int>>> nodes;
+		struct dirent* entry;
+		while ((entry = readdir(nodeDir)) != NULL) {
+			int node;
+			char extra;
+			if (sscanf(entry->d_name, "node%d%c", &node, &extra) != 1)
+				continue;
+			char path[96];
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+			FILE* file = fopen(path, "r");
+			if (file == NULL)
+				continue;
+			char text[4096] = "";
+			if (fgets(text, sizeof(text), file) != NULL) {
+				std::vector<int> cpus;
+				for (int cpu : parseCpuList(text)) {
+					if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+						cpus.push_back(cpu);
+				}
+				if (!cpus.empty())
+					nodes.emplace_back(node, cpus);
+			}
+			fclose(file);
+		}
+		closedir(nodeDir);
+		std::sort(nodes.begin(), nodes.end());
+		for (auto& node : nodes) {
+			topology.nodes.push_back(node.first);
+			topology.nodeCpus.push_back(node.second);
+		}
+	}
+
+	//	No NUMA information: all the CPUs we may run on, as node 0
+	if (topology.nodes.empty()) {
+		std::vector<int> cpus;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &allowed))
+				cpus.push_back(cpu);
+		}
+		topology.nodes.push_back(0);
+		topology.nodeCpus.push_back(cpus.empty() ? std::vector<int>{0} : cpus);
+	}
+	return topology;
+}
+
+std::vector<ThreadPlacement> placeThreads(const CpuTopology& topology, unsigned int numThreads) {
+	size_t totalCpus = 0;
+	for (const auto& cpus : topology.nodeCpus)
+		totalCpus += cpus.size();
+
+	//	Node k takes the threads from the rounded running share of the nodes before it
+	//	to the rounded running share including it
+	std::vector<ThreadPlacement> placement;
+	size_t cpusBefore = 0;
+	for (size_t k = 0; k < topology.nodes.size(); k++) {
+		const std::vector<int>& cpus = topology.nodeCpus[k];
+		unsigned int first = (unsigned int) ((cpusBefore * numThreads + totalCpus / 2) / totalCpus);
+		cpusBefore += cpus.size();
+		unsigned int last = (unsigned int) ((cpusBefore * numThreads + totalCpus / 2) / totalCpus);
+		for (unsigned int i = first; i < last; i++)
+			placement.push_back({cpus[(i - first) % cpus.size()], topology.nodes[k]});
+	}
+	return placement;
+}
+
+bool pinCurrentThread(int cpu) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool placeMemoryOnNode(void* address, size_t length, int node) {
+	if (node < 0 || node >= 64 || length == 0)
+		return false;
+	uintptr_t pageSize = (uintptr_t) sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t) address & ~(pageSize - 1);
+	uintptr_t end = ((uintptr_t) address + length + pageSize - 1) & ~(pageSize - 1);
+	unsigned long nodeMask = 1ul << node;
+	return syscall(SYS_mbind, start, end - start, MPOL_PREFERRED_MODE, &nodeMask,
+				   sizeof(nodeMask) * 8, MPOL_MF_MOVE_FLAG) == 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file CpuTopology.h
+ * @brief NUMA topology, thread pinning and placement of memory on a node
+ *
+ * The topology is read from sysfs (/sys/devices/system/node), restricted to
+ * the CPUs the process may run on; a machine (or container) without NUMA
+ * information is a single node.  Memory is placed with the mbind system
+ * call, so libnuma isn't needed.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct CpuTopology
+ * @brief The CPUs of each NUMA node that the process may run on.
+ */
+struct CpuTopology {
+	/** @brief Node numbers, in increasing order (only nodes with usable CPUs). */
+	std::vector<int> nodes;
+
+	/** @brief CPUs of each node, in increasing order. */
+	std::vector<std::vector<int>> nodeCpus;
+};
+
+/**
+ * @struct ThreadPlacement
+ * @brief Where a focusing thread runs.
+ */
+struct ThreadPlacement {
+	/** @brief CPU the thread is pinned to. */
+	int cpu;
+
+	/** @brief NUMA node of that CPU. */
+	int node;
+};
+
+/**
+ * @brief Reads the NUMA topology of the machine
+ * @return The topology (a single node if sysfs has no NUMA information)
+ */
+CpuTopology readCpuTopology(void);
+
+/**
+ * @brief Places the threads on the CPUs, node by node
+ *
+ * Each node gets a share of the threads proportional to its number of CPUs,
+ * and consecutive threads share a node, so that consecutive row bands (and
+ * the memory under them) do too.  Threads beyond the number of CPUs of a
+ * node wrap around its CPUs.
+ * @param topology Topology of the machine
+ * @param numThreads Number of focusing threads
+ * @return The placement of each thread
+ */
+std::vector<ThreadPlacement> placeThreads(const CpuTopology& topology, unsigned int numThreads);
+
+/**
+ * @brief Pins the calling thread to a CPU
+ * @param cpu The CPU
+ * @return false if the system refused
+ */
+bool pinCurrentThread(int cpu);
+
+/**
+ * @brief Moves a range of memory to a NUMA node (pages not touched yet will be allocated there)
+ *
+ * The range is widened to whole pages, so a page shared with a neighboring
+ * range ends up on whichever node is placed last.
+ * @param address Start of the range
+ * @param length Length of the range, in bytes
+ * @param node The node
+ * @return false if the system refused (e.g. a kernel without NUMA support)
+ */
+bool placeMemoryOnNode(void* address, size_t length, int node);
+
+#endif // CPU_TOPOLOGY_H
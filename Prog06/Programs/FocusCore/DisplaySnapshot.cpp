@@ -0,0 +1,92 @@
+/**
+ * @file DisplaySnapshot.cpp
+ * @brief Tear-free copy of the output image for the GUI
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "DisplaySnapshot.h"
+
+DisplaySnapshot::DisplaySnapshot(const RasterImage* theSource, unsigned int theTileSize)
+		:	source(theSource),
+			copy(new RasterImage(theSource->width, theSource->height, theSource->type)),
+			tileSize(theTileSize),
+			tilesX((theSource->width + theTileSize - 1) / theTileSize),
+			tilesY((theSource->height + theTileSize - 1) / theTileSize),
+			tiles(tilesX * tilesY),
+			shownVersion(tilesX * tilesY, 0),
+			scratch(static_cast<size_t>(theTileSize) * theTileSize * theSource->bytesPerPixel)
+{
+	copy->maxVal = theSource->maxVal;
+}
+
+DisplaySnapshot::~DisplaySnapshot(void) {
+	delete copy;
+}
+
+void DisplaySnapshot::beginWrite(unsigned int rowMin, unsigned int rowMax, unsigned int colMin, unsigned int colMax) {
+	for (unsigned int ty = rowMin / tileSize; ty <= rowMax / tileSize; ty++)
+		for (unsigned int tx = colMin / tileSize; tx <= colMax / tileSize; tx++)
+			tiles[ty * tilesX + tx].writers.fetch_add(1, std::memory_order_relaxed);
+	//	the pixel writes must not become visible before the writer counts
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void DisplaySnapshot::endWrite(unsigned int rowMin, unsigned int rowMax, unsigned int colMin, unsigned int colMax) {
+	for (unsigned int ty = rowMin / tileSize; ty <= rowMax / tileSize; ty++) {
+		for (unsigned int tx = colMin / tileSize; tx <= colMax / tileSize; tx++) {
+			TileSeq& tile = tiles[ty * tilesX + tx];
+			tile.version.fetch_add(1, std::memory_order_release);
+			tile.writers.fetch_sub(1, std::memory_order_release);
+		}
+	}
+}
+
+void DisplaySnapshot::tileBounds(unsigned int tileIndex, unsigned int& row, unsigned int& col,
+								 unsigned int& numRows, unsigned int& numCols) const {
+	row = (tileIndex / tilesX) * tileSize;
+	col = (tileIndex % tilesX) * tileSize;
+	numRows = std::min(row + tileSize, source->height) - row;
+	numCols = std::min(col + tileSize, source->width) - col;
+}
+
+unsigned int DisplaySnapshot::refresh(void) {
+	refreshed.clear();
+	const unsigned char* src = static_cast<const unsigned char*>(source->raster);
+	unsigned char* dst = static_cast<unsigned char*>(copy->raster);
+
+	for (unsigned int t = 0; t < tilesX * tilesY; t++) {
+		TileSeq& tile = tiles[t];
+		uint64_t version = tile.version.load(std::memory_order_acquire);
+		if (version == shownVersion[t] || tile.writers.load(std::memory_order_acquire) != 0)
+			continue;
+
+		//	The tile is read into the scratch buffer first, not into the display buffer
+		unsigned int rowMin, colMin, numRows, numCols;
+		tileBounds(t, rowMin, colMin, numRows, numCols);
+		size_t offset = static_cast<size_t>(colMin) * source->bytesPerPixel;
+		size_t numBytes = static_cast<size_t>(numCols) * source->bytesPerPixel;
+		for (unsigned int row = 0; row < numRows; row++) {
+			size_t start = static_cast<size_t>(rowMin + row) * source->bytesPerRow + offset;
+			memcpy(scratch.data() + row * numBytes, src + start, numBytes);
+		}
+
+		//	a writer that came in during the copy may have torn it: the tile
+		//	stays out of date (the display buffer keeps its previous contents)
+		//	and is copied again at the next refresh
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (tile.writers.load(std::memory_order_relaxed) != 0 ||
+				tile.version.load(std::memory_order_relaxed) != version)
+			continue;
+		for (unsigned int row = 0; row < numRows; row++) {
+			size_t start = static_cast<size_t>(rowMin + row) * source->bytesPerRow + offset;
+			memcpy(dst + start, scratch.data() + row * numBytes, numBytes);
+		}
+		shownVersion[t] = version;
+		refreshed.push_back(t);
+	}
+	return static_cast<unsigned int>(refreshed.size());
+}
@@ -0,0 +1,114 @@
+/**
+ * @file DisplaySnapshot.h
+ * @brief Tear-free copy of the output image for the GUI
+ *
+ * The output image is split into square display tiles, each guarded by a
+ * multi-writer sequence lock: a count of the writers currently in the tile
+ * and a version bumped by every completed write.  Workers announce each
+ * write with beginWrite/endWrite (two atomic operations per tile, no lock),
+ * and the display thread copies a tile into a scratch buffer only when its
+ * version changed, then into its own buffer only if no writer touched the
+ * tile meanwhile.  A tile caught mid-write simply keeps its previous contents
+ * until the next refresh, so neither side ever waits for the other, and the
+ * display buffer never holds a torn tile.
+ *
+ * The tiles copied by a refresh are the dirty tiles: the only ones the front
+ * end needs to upload to the GPU for the next frame.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef DISPLAY_SNAPSHOT_H
+#define DISPLAY_SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "RasterImage.h"
+#include "FocusStats.h"
+
+/** @brief Side of the display tiles, in pixels. */
+const unsigned int DISPLAY_TILE_SIZE = 64;
+
+/**
+ * @class DisplaySnapshot
+ * @brief Double buffer of the output image, refreshed tile by tile under seqlocks.
+ */
+class DisplaySnapshot {
+public:
+	/**
+	 * @brief Creates the display copy of an image (initially blank, like the image).
+	 * @param source The image the workers write to
+	 * @param tileSize Side of the display tiles
+	 */
+	DisplaySnapshot(const RasterImage* source, unsigned int tileSize = DISPLAY_TILE_SIZE);
+
+	~DisplaySnapshot(void);
+
+	DisplaySnapshot(const DisplaySnapshot&) = delete;
+	DisplaySnapshot& operator=(const DisplaySnapshot&) = delete;
+
+	/**
+	 * @brief Announces a write to a rectangle of the source image (bounds are
+	 *	inclusive and must already be clipped to the image).
+	 */
+	void beginWrite(unsigned int rowMin, unsigned int rowMax, unsigned int colMin, unsigned int colMax);
+
+	/** @brief Ends a write announced by beginWrite, with the same bounds. */
+	void endWrite(unsigned int rowMin, unsigned int rowMax, unsigned int colMin, unsigned int colMax);
+
+	/**
+	 * @brief Copies into the display buffer every tile that changed since the
+	 *	last refresh and is not being written.  Called by the display thread only.
+	 * @return Number of tiles copied
+	 */
+	unsigned int refresh(void);
+
+	/** @brief The display buffer (valid until the next refresh). */
+	const RasterImage* image(void) const { return copy; }
+
+	/** @brief Tiles copied by the last refresh, in increasing order. */
+	const std::vector<unsigned int>& refreshedTiles(void) const { return refreshed; }
+
+	/** @brief Total number of tiles. */
+	unsigned int numTiles(void) const { return tilesX * tilesY; }
+
+	/**
+	 * @brief Finds the pixels of a tile (clipped to the image).
+	 * @param tileIndex Index of the tile
+	 * @param row Receives the first row of the tile
+	 * @param col Receives the first column of the tile
+	 * @param numRows Receives the number of rows of the tile
+	 * @param numCols Receives the number of columns of the tile
+	 */
+	void tileBounds(unsigned int tileIndex, unsigned int& row, unsigned int& col,
+					unsigned int& numRows, unsigned int& numCols) const;
+
+private:
+	/**
+	 * @struct TileSeq
+	 * @brief Sequence lock of one tile, alone on its cache line.
+	 */
+	struct alignas(CACHE_LINE_SIZE) TileSeq {
+		/** @brief Number of writers currently inside the tile. */
+		std::atomic<unsigned int> writers{0};
+		/** @brief Number of completed writes to the tile. */
+		std::atomic<uint64_t> version{0};
+	};
+
+	const RasterImage* source;
+	RasterImage* copy;
+	unsigned int tileSize;
+	unsigned int tilesX;
+	unsigned int tilesY;
+	std::vector<TileSeq> tiles;
+	/** @brief Version of each tile currently in the display buffer. */
+	std::vector<uint64_t> shownVersion;
+	/** @brief Tiles copied by the last refresh. */
+	std::vector<unsigned int> refreshed;
+	/** @brief A tile read from the source, kept only once checked. */
+	std::vector<unsigned char> scratch;
+};
+
+#endif	//	DISPLAY_SNAPSHOT_H
@@ -0,0 +1,86 @@
+/**
+ * @file FastRandom.h
+ * @brief Small, fast per-thread random generator for window sampling
+ *
+ * xoshiro256** (Blackman & Vigna) seeded through splitmix64 from a run seed
+ * and the thread index, so every run with the same seed and thread count
+ * draws exactly the same windows.  Bounded integers use Lemire's
+ * multiply-shift method, which is bias-free and needs no division in the
+ * common case.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef FAST_RANDOM_H
+#define FAST_RANDOM_H
+
+#include <cstdint>
+
+/** @brief Run seed used when none is given on the command line. */
+const uint64_t DEFAULT_RUN_SEED = 412;
+
+/**
+ * @class FastRandom
+ * @brief xoshiro256** generator.  Not thread-safe: one per thread.
+ */
+class FastRandom {
+public:
+	/**
+	 * @brief Seeds the generator from a run seed and a thread index.
+	 * @param runSeed Seed shared by all the threads of a run
+	 * @param threadIndex Index of the thread owning this generator
+	 */
+	FastRandom(uint64_t runSeed, uint64_t threadIndex) {
+		uint64_t x = runSeed ^ (0x9E3779B97F4A7C15ULL * (threadIndex + 1));
+		for (int k = 0; k < 4; k++)
+			state[k] = splitMix64(x);
+	}
+
+	/** @brief Returns 64 uniformly distributed random bits. */
+	uint64_t next(void) {
+		const uint64_t result = rotl(state[1] * 5, 7) * 9;
+		const uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 45);
+		return result;
+	}
+
+	/**
+	 * @brief Returns an integer uniformly distributed in [0, bound).
+	 * @param bound Upper bound (excluded), must be positive
+	 */
+	uint32_t below(uint32_t bound) {
+		uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>(next() >> 32)) * bound;
+		uint32_t low = static_cast<uint32_t>(m);
+		if (low < bound) {
+			//	reject the few values that would bias the result
+			uint32_t threshold = -bound % bound;
+			while (low < threshold) {
+				m = static_cast<uint64_t>(static_cast<uint32_t>(next() >> 32)) * bound;
+				low = static_cast<uint32_t>(m);
+			}
+		}
+		return static_cast<uint32_t>(m >> 32);
+	}
+
+private:
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+	static uint64_t splitMix64(uint64_t& x) {
+		uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t state[4];
+};
+
+#endif	//	FAST_RANDOM_H
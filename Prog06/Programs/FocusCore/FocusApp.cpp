@@ -0,0 +1,223 @@
+/**
+ * @file FocusApp.cpp
+ * @brief Front end of a focusing program: GUI (or none, when headless) and output
+ *
+ * The GUI callbacks declared in gl_frontEnd.h are implemented here, once for
+ * all the programs: the image pane draws the display copy of the output, the
+ * state pane shows the throughput dashboard.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#ifndef FOCUS_HEADLESS
+#include "gl_frontEnd.h"
+#include "ImageTexture.h"
+#endif
+#include "ImageIO.h"
+#include "FocusStats.h"
+#include "Checkpoint.h"
+#include "FocusApp.h"
+
+/** @brief Context of the run being displayed. */
+static FocusContext* appContext = nullptr;
+
+#ifndef FOCUS_HEADLESS
+/** @brief Maximum number of messages to display. */
+const int MAX_NUM_MESSAGES = 8;
+
+/** @brief Maximum length of each message. */
+const int MAX_LENGTH_MESSAGE = 32;
+
+/** @brief Period over which the state pane measures the rates, in seconds. */
+const double DASHBOARD_PERIOD = 1.0;
+
+/** @brief Array of messages for display. */
+static char** message;
+
+/** @brief Number of messages currently used. */
+static int numMessages;
+
+/** @brief Text of the state pane as last composed, to detect changes. */
+static std::string stateText;
+
+/** @brief Texture the display copy is streamed to. */
+static ImageTexture* imageTexture;
+
+/**
+ * @brief Displays the processed image.
+ *
+ * @param scaleX Scaling for x.
+ * @param scaleY Scaling for y.
+ */
+void displayImage(GLfloat scaleX, GLfloat scaleY)
+{
+	//==============================================
+	//	This is OpenGL/glut magic.  Don't touch
+	//==============================================
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	//	Draw the display copy, never the image being written to:
+	//	only the tiles that changed since the last frame are uploaded
+	appContext->displaySnapshot->refresh();
+	imageTexture->upload();
+	imageTexture->draw(scaleX * appContext->imageOut->width, scaleY * appContext->imageOut->height);
+}
+
+/**
+ * @brief Composes the information displayed to the side of the GUI window
+ * @return true if the text changed since the last call
+ */
+bool updateState(void)
+{
+	//	Rates are measured over DASHBOARD_PERIOD rather than between two
+	//	frames, so they are readable and the pane isn't redrawn at every frame.
+	//	Once the run is over, the figures are the averages of the whole run.
+	static StatsSnapshot previous = {};
+	static double previousCoverage = 0.0;
+	static bool finished = false;
+	StatsSnapshot stats = gatherStats();
+	double interval = stats.elapsedSeconds - previous.elapsedSeconds;
+	if (finished || (!stateText.empty() && interval < DASHBOARD_PERIOD))
+		return false;
+
+	double coverageNow = appContext->coverage->fractionCovered();
+	finished = (stats.liveThreads == 0 && appContext->coverage->isComplete());
+	StatsRates rates = computeRates(finished ? StatsSnapshot{} : previous, stats);
+
+	numMessages = 7;
+	if (finished)
+		snprintf(message[0], MAX_LENGTH_MESSAGE+1, "Time: %.1f s, done", stats.elapsedSeconds);
+	else if (coverageNow > previousCoverage)
+		snprintf(message[0], MAX_LENGTH_MESSAGE+1, "Time: %.0f s, ETA: %.0f s", stats.elapsedSeconds,
+				 (1.0 - coverageNow) * interval / (coverageNow - previousCoverage));
+	else
+		snprintf(message[0], MAX_LENGTH_MESSAGE+1, "Time: %.0f s, ETA: --", stats.elapsedSeconds);
+	snprintf(message[1], MAX_LENGTH_MESSAGE+1, "Coverage: %.1f%%", 100.0 * coverageNow);
+	snprintf(message[2], MAX_LENGTH_MESSAGE+1, "Windows/s: %.0f", rates.windowsPerSecond);
+	snprintf(message[3], MAX_LENGTH_MESSAGE+1, "MPix/s: %.2f", rates.megapixelsPerSecond);
+	snprintf(message[4], MAX_LENGTH_MESSAGE+1, "Util min/avg/max: %.0f/%.0f/%.0f%%",
+			 100.0 * stats.minUtilization, 100.0 * stats.avgUtilization, 100.0 * stats.maxUtilization);
+	snprintf(message[5], MAX_LENGTH_MESSAGE+1, "Lock wait: %.1f%% (%llu)", rates.lockWaitPercent,
+			 (unsigned long long) stats.lockWaits);
+	if (appContext->backend != nullptr)
+		snprintf(message[6], MAX_LENGTH_MESSAGE+1, "Threads: %u (%s%s)", stats.numThreads, appContext->backend->name(),
+				 appContext->placement.empty() ? "" : ", pinned");
+	else
+		snprintf(message[6], MAX_LENGTH_MESSAGE+1, "Threads: %u", stats.numThreads);
+	if (appContext->locking != nullptr)
+		snprintf(message[numMessages++], MAX_LENGTH_MESSAGE+1, "%s", appContext->locking->describe().c_str());
+	previous = stats;
+	previousCoverage = coverageNow;
+
+	//	Only report a change if the text differs from the one on screen
+	std::string text;
+	for (int k=0; k<numMessages; k++)
+		text.append(message[k]).push_back('\n');
+	bool changed = (text != stateText);
+	stateText.swap(text);
+	return changed;
+}
+
+/**
+ * @brief Displays the information to the side of the GUI window
+ */
+void displayState(void)
+{
+	//==============================================
+	//	This is OpenGL/glut magic.  Don't touch
+	//==============================================
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	//	The front end composes the messages before each redraw of the pane
+	//	(through updateState); compose them here only if it never has
+	if (stateText.empty())
+		updateState();
+
+	drawState(numMessages, message);
+}
+#endif
+
+/**
+ * @brief Cleans up and exits the application.
+ *
+ * this function writes the image and cleans up any allocated memory
+ */
+[[noreturn]] static void cleanupAndQuit(void)
+{
+	stopStatsReporter();
+
+	//	The checkpoint writer may already have written it
+	if (appContext->checkpointWriter != nullptr)
+		appContext->checkpointWriter->finish();
+	else
+		writeImageAtomically(appContext->options.outputPath.c_str(), appContext->imageOut, appContext->options.compressOutput);
+
+#ifndef FOCUS_HEADLESS
+	for (int k=0; k<MAX_NUM_MESSAGES; k++)
+		free(message[k]);
+	free(message);
+#endif
+
+	exit(0);
+}
+
+#ifndef FOCUS_HEADLESS
+/**
+ * @brief Watches for keyboard control
+ *
+ */
+void handleKeyboardEvent(unsigned char c, int x, int y)
+{
+	switch (c)
+	{
+		//	'esc' to quit
+		case 27:
+			cleanupAndQuit();
+			break;
+
+		default:
+			break;
+	}
+}
+#endif
+
+void startFocusDisplay(int argc, char** argv, FocusContext* ctx) {
+	appContext = ctx;
+#ifndef FOCUS_HEADLESS
+	message = (char**) malloc(MAX_NUM_MESSAGES*sizeof(char*));
+	for (int k=0; k<MAX_NUM_MESSAGES; k++)
+		message[k] = (char*) malloc((MAX_LENGTH_MESSAGE+1)*sizeof(char));
+	imageTexture = new ImageTexture(ctx->displaySnapshot);
+
+	if (ctx->options.maxFrameRate > 0)
+		setMaxFrameRate(ctx->options.maxFrameRate);
+	//	argc and argv are passed on to glutInit
+	initializeFrontEnd(argc, argv, ctx->imageOut);
+#endif
+}
+
+void runFocusDisplay(void) {
+#ifndef FOCUS_HEADLESS
+	//	The callbacks set up by initializeFrontEnd take over from here: the
+	//	program exits from handleKeyboardEvent
+	glutMainLoop();
+#endif
+}
+
+void finishFocus(FocusContext* ctx) {
+	appContext = ctx;
+	//	Without a GUI there is no key to press: write the output once the threads are done
+	stopStatsReporter();
+	if (ctx->backend != nullptr)
+		fprintf(stderr, "%s back-end: ", ctx->backend->name());
+	printStatsSummary();
+	cleanupAndQuit();
+}
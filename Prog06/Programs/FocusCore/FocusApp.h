@@ -0,0 +1,37 @@
+/**
+ * @file FocusApp.h
+ * @brief Front end of a focusing program: GUI (or none, when headless) and output
+ *
+ * A program calls startFocusDisplay before it starts its threads,
+ * runFocusDisplay once they are started (the GLUT main loop, which only
+ * returns in headless builds), then finishFocus once they are joined.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef FOCUS_APP_H
+#define FOCUS_APP_H
+
+#include "FocusEngine.h"
+
+/**
+ * @brief Opens the GUI window on the output image (nothing when headless)
+ * @param argc Argument count (passed on to glutInit)
+ * @param argv Argument vector (passed on to glutInit)
+ * @param ctx Context of the run
+ */
+void startFocusDisplay(int argc, char** argv, FocusContext* ctx);
+
+/**
+ * @brief Enters the GLUT main loop, which exits on 'esc' (returns at once when headless)
+ */
+void runFocusDisplay(void);
+
+/**
+ * @brief Prints the statistics, writes the output image and exits
+ * @param ctx Context of the run
+ */
+[[noreturn]] void finishFocus(FocusContext* ctx);
+
+#endif // FOCUS_APP_H
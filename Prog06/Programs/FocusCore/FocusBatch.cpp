@@ -0,0 +1,304 @@
+/**
+ * @file FocusBatch.cpp
+ * @brief Focusing of many stacks in one process, from a manifest
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "FocusBatch.h"
+#include "FocusStats.h"
+#include "ImageIO.h"
+#include "ThreadTuning.h"
+
+/** @brief Largest number of focusing threads accepted on the command line. */
+static const long MAX_THREADS = 4096;
+
+/**
+ * @struct BatchSlot
+ * @brief A job on its way through the pipeline.
+ */
+struct BatchSlot {
+	/** @brief Index of the job. */
+	size_t jobIndex;
+
+	/** @brief Context of the job, with its stack loaded (nullptr if it couldn't be). */
+	FocusContext* ctx;
+
+	/** @brief Time the stack took to focus, in seconds. */
+	double focusSeconds;
+
+	/** @brief Why the stack couldn't be loaded (if ctx is nullptr). */
+	std::string error;
+};
+
+/**
+ * @class BatchQueue
+ * @brief Hands the jobs from one stage of the pipeline to the next.
+ *
+ * Holds at most one job: a stage that is ahead waits for the next one.
+ */
+class BatchQueue {
+public:
+	/**
+	 * @brief Hands a job to the next stage, once the previous one was taken
+	 * @param slot The job
+	 */
+	void push(const BatchSlot& slot) {
+		std::unique_lock<std::mutex> lock(mutex);
+		taken.wait(lock, [this] { return slots.empty(); });
+		slots.push_back(slot);
+		available.notify_one();
+	}
+
+	/** @brief Tells the next stage that no more jobs will come. */
+	void close(void) {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		available.notify_one();
+	}
+
+	/**
+	 * @brief Takes the next job
+	 * @param slot Receives the job
+	 * @return false once the queue is closed and empty
+	 */
+	bool pop(BatchSlot& slot) {
+		std::unique_lock<std::mutex> lock(mutex);
+		available.wait(lock, [this] { return !slots.empty() || closed; });
+		if (slots.empty())
+			return false;
+		slot = slots.front();
+		slots.pop_front();
+		taken.notify_one();
+		return true;
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable available;
+	std::condition_variable taken;
+	std::deque<BatchSlot> slots;
+	bool closed = false;
+};
+
+bool applyJobOption(const char* flag, FocusOptions& options, int& windowSize) {
+	if (strcmp(flag, "--blend") == 0)
+		options.blend = true;
+	else if (strcmp(flag, "--rle") == 0)
+		options.compressOutput = true;
+	else if (strncmp(flag, "--roi=", 6) == 0)
+		return parseRegionSpec(flag + 6, options.roi);
+	else if (strncmp(flag, "--window=", 9) == 0) {
+		char* end = NULL;
+		long size = strtol(flag + 9, &end, 10);
+		if (*end != '\0' || size < 1 || size > 255)
+			return false;
+		windowSize = (int) size;
+	}
+	else
+		return false;
+	return true;
+}
+
+bool listStackFiles(const std::string& folder, std::vector<std::string>& paths) {
+	std::error_code error;
+	std::filesystem::directory_iterator entries(folder, error);
+	if (error)
+		return false;
+	for (const std::filesystem::directory_entry& entry : entries) {
+		std::string name = entry.path().filename().string();
+		if (name[0] != '.' && entry.is_regular_file(error) && imageFileType(name.c_str()) != kUnknownType)
+			paths.push_back(entry.path().string());
+	}
+	std::sort(paths.begin(), paths.end());
+	return !paths.empty();
+}
+
+bool parseBatchOptions(int argc, char** argv, BatchOptions& options) {
+	std::vector<char*> args;
+	bool badOption = false;
+	for (int i = 0; i < argc; i++) {
+		if (strncmp(argv[i], "--stats=", 8) == 0)
+			options.defaults.statsPeriodMs = atoi(argv[i] + 8);
+		else if (strcmp(argv[i], "--stats-json") == 0)
+			options.defaults.statsJSON = true;
+		else if (strncmp(argv[i], "--backend=", 10) == 0)
+			options.defaults.backendName = argv[i] + 10;
+		else if (strcmp(argv[i], "--recalibrate") == 0)
+			options.defaults.recalibrate = true;
+		else if (strncmp(argv[i], "--map-cache=", 12) == 0)
+			options.defaults.mapCacheDir = argv[i] + 12;
+		else if (strncmp(argv[i], "--", 2) == 0)
+			badOption |= !applyJobOption(argv[i], options.defaults, options.windowSize);
+		else
+			args.push_back(argv[i]);
+	}
+	if (options.defaults.statsJSON && options.defaults.statsPeriodMs == 0)
+		options.defaults.statsPeriodMs = 1000;
+
+	//	The number of threads is "auto" or a positive integer
+	char* end = NULL;
+	long numThreads = (args.size() != 3) ? 0 : strtol(args[1], &end, 10);
+	bool autoThreads = (args.size() == 3 && strcmp(args[1], "auto") == 0);
+	if (badOption || args.size() != 3 || (!autoThreads && (*end != '\0' || numThreads < 1 || numThreads > MAX_THREADS))) {
+		fprintf(stderr, "Usage: %s [--stats=<ms>] [--stats-json] [--backend=<name>] [--recalibrate] [--map-cache=<dir>] "
+				"[--blend] [--rle] [--roi=<w>x<h>+<x>+<y>] [--window=<n>] <num_threads>|auto <manifest>\n"
+				"Manifest lines: <input_folder> <output_path> [--blend] [--rle] [--roi=<w>x<h>+<x>+<y>] [--window=<n>]\n"
+				"Back-ends: %s\n", argv[0], availableThreadBackends());
+		return false;
+	}
+
+	options.defaults.numThreads = autoThreads ? 0 : (unsigned int) numThreads;
+	options.manifestPath = args[2];
+	return true;
+}
+
+bool parseBatchJob(const std::string& text, const BatchOptions& options, BatchJob& job, std::string& error) {
+	std::istringstream fields(text);
+	std::string inputFolder, outputPath, flag;
+	if (!(fields >> inputFolder) || inputFolder[0] == '#')
+		return true;
+	if (!(fields >> outputPath)) {
+		error = "no output path";
+		return false;
+	}
+	job.inputFolder = inputFolder;
+	job.options = options.defaults;
+	job.options.outputPath = outputPath;
+	job.windowSize = options.windowSize;
+	while (fields >> flag) {
+		if (!applyJobOption(flag.c_str(), job.options, job.windowSize)) {
+			error = "unknown or invalid option " + flag;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool readBatchManifest(const BatchOptions& options, std::vector<BatchJob>& jobs) {
+	std::ifstream manifest(options.manifestPath);
+	if (!manifest) {
+		fprintf(stderr, "Cannot open the manifest %s\n", options.manifestPath.c_str());
+		return false;
+	}
+
+	bool valid = true;
+	std::string text;
+	for (unsigned int line = 1; std::getline(manifest, text); line++) {
+		BatchJob job;
+		std::string error;
+		if (!parseBatchJob(text, options, job, error)) {
+			fprintf(stderr, "%s:%u: %s\n", options.manifestPath.c_str(), line, error.c_str());
+			valid = false;
+		}
+		else if (!job.inputFolder.empty()) {
+			job.line = line;
+			jobs.push_back(job);
+		}
+	}
+	if (valid && jobs.empty())
+		fprintf(stderr, "The manifest %s has no job\n", options.manifestPath.c_str());
+	return valid && !jobs.empty();
+}
+
+void startJobFocus(ThreadBackend* backend, FocusContext* ctx) {
+	backend->start(ctx->options.numThreads, [ctx](unsigned int i) {
+		int startRow, endRow;
+		threadRowBand(ctx, i, startRow, endRow);
+		if (ctx->options.blend)
+			blendPixelRows(ctx, startRow, endRow, i);
+		else
+			focusPixelRows(ctx, startRow, endRow, i);
+	});
+}
+
+unsigned int runBatch(const BatchOptions& options, std::vector<BatchJob>& jobs) {
+	ThreadBackend* backend = selectThreadBackend(options.defaults.backendName, "pool");
+	unsigned int numThreads = options.defaults.numThreads;
+	BatchQueue loaded, focused;
+
+	//	Stage 1: the stacks are loaded one job ahead of the focusing
+	std::thread loader([&] {
+		for (size_t k = 0; k < jobs.size(); k++) {
+			BatchJob& job = jobs[k];
+			BatchSlot slot = {k, nullptr, 0.0, ""};
+			//	A stack that can't be loaded fails its job only
+			if (listStackFiles(job.inputFolder, job.options.inputPaths))
+				slot.ctx = loadFocusStack(job.options, job.windowSize, &slot.error);
+			else
+				slot.error = "no image in " + job.inputFolder;
+			loaded.push(slot);
+		}
+		loaded.close();
+	});
+
+	//	Stage 3: the outputs are written one job behind
+	unsigned int numFailed = 0;
+	std::thread writer([&] {
+		BatchSlot slot;
+		while (focused.pop(slot)) {
+			if (slot.ctx == nullptr) {
+				fprintf(stderr, "%s:%u: %s\n", options.manifestPath.c_str(), jobs[slot.jobIndex].line, slot.error.c_str());
+				numFailed++;
+				continue;
+			}
+			const FocusOptions& jobOptions = slot.ctx->options;
+			if (writeImageAtomically(jobOptions.outputPath.c_str(), slot.ctx->imageOut, jobOptions.compressOutput) != kNoIOerror)
+				numFailed++;
+			else
+				fprintf(stderr, "[%zu/%zu] %s: %zu layers of %ux%u, focused in %.3f s\n", slot.jobIndex + 1, jobs.size(),
+						jobOptions.outputPath.c_str(), slot.ctx->imageStack.size(), slot.ctx->imageOut->width,
+						slot.ctx->imageOut->height, slot.focusSeconds);
+			releaseFocusContext(slot.ctx);
+		}
+	});
+
+	//	Stage 2: the threads of the back-end focus one stack after the other
+	bool started = false;
+	BatchSlot slot;
+	while (loaded.pop(slot)) {
+		FocusContext* ctx = slot.ctx;
+		if (ctx != nullptr) {
+			//	"auto" is resolved on the first stack, for the whole batch
+			if (!started) {
+				if (numThreads == 0)
+					numThreads = autotuneThreads(ctx, options.defaults.recalibrate);
+				initializeStats(numThreads);
+				if (options.defaults.statsPeriodMs > 0)
+					startStatsReporter(options.defaults.statsPeriodMs, options.defaults.statsJSON);
+				started = true;
+			}
+			ctx->options.numThreads = numThreads;
+			uint64_t start = statsNow();
+			startJobFocus(backend, ctx);
+			backend->wait();
+			slot.focusSeconds = (statsNow() - start) * 1.0e-9;
+		}
+		focused.push(slot);
+	}
+	focused.close();
+
+	loader.join();
+	writer.join();
+
+	if (started) {
+		stopStatsReporter();
+		fprintf(stderr, "%s back-end: ", backend->name());
+		printStatsSummary();
+	}
+	delete backend;
+	fprintf(stderr, "%zu jobs, %u failed\n", jobs.size(), numFailed);
+	return numFailed;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file FocusBatch.h
+ * @brief Focusing of many stacks in one process, from a manifest
+ *
+ * Each line of a manifest is a job: the folder of a stack (its .tga, .ppm,
+ * .pgm and .pnm files, in name order, as Scripts/script06.sh passes them),
+ * the path of the output, then options of the job:
+ *
+ *	# folder          output             options
+ *	stacks/bee        out/bee.tga        --window=11
+ *	stacks/slide_12   out/slide_12.pgm   --blend --roi=1000x1000+2500+1800
+ *
+ * Empty lines and lines starting with '#' are skipped; paths can't contain
+ * spaces.  The job options are --blend, --rle, --roi=<w>x<h>+<x>+<y> and
+ * --window=<n> (side of the window, 5 by default); given on the command
+ * line of the batch, they apply to every job.  The stacks are focused as
+ * Version1 does (each thread a band of rows, no locking).
+ *
+ * The jobs go through a pipeline of three stages: a loader thread reads
+ * stack k+1 while the threads of the back-end (persistent, "pool" by
+ * default) focus stack k, and a writer thread writes the output of stack
+ * k-1.  At most one stack waits between two stages, so a batch holds at
+ * most five stacks in memory.  A job whose folder holds no image, whose
+ * layers can't be read, or whose layers don't make a stack fails without
+ * stopping the batch.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef FOCUS_BATCH_H
+#define FOCUS_BATCH_H
+
+#include <string>
+#include <vector>
+#include "FocusEngine.h"
+
+/** @brief Side of the window of a job that doesn't give --window (that of Version1). */
+const int DEFAULT_BATCH_WINDOW_SIZE = 5;
+
+/**
+ * @struct BatchOptions
+ * @brief Command line of the batch driver.
+ */
+struct BatchOptions {
+	/** @brief Options of the whole process (threads, back-end, statistics), and defaults of the jobs. */
+	FocusOptions defaults;
+
+	/** @brief Side of the window of the jobs that don't give one. */
+	int windowSize = DEFAULT_BATCH_WINDOW_SIZE;
+
+	/** @brief Path to the manifest. */
+	std::string manifestPath;
+};
+
+/**
+ * @struct BatchJob
+ * @brief One line of a manifest.
+ */
+struct BatchJob {
+	/** @brief Line of the job in the manifest. */
+	unsigned int line = 0;
+
+	/** @brief Folder of the layers of the stack. */
+	std::string inputFolder;
+
+	/** @brief Options of the job (its input paths are filled in when the stack is loaded). */
+	FocusOptions options;
+
+	/** @brief Side of the window examined around each pixel. */
+	int windowSize = DEFAULT_BATCH_WINDOW_SIZE;
+};
+
+/**
+ * @brief Pulls the options out of the command line of the batch driver
+ *
+ * Prints the usage line if the command line is incomplete.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param options Receives the options
+ * @return false if the command line is incomplete
+ */
+bool parseBatchOptions(int argc, char** argv, BatchOptions& options);
+
+/**
+ * @brief Applies an option of a job (--blend, --rle, --roi or --window)
+ * @param flag The option, e.g. "--window=11"
+ * @param options Options of the job
+ * @param windowSize Side of the window of the job
+ * @return false if the option isn't a valid job option
+ */
+bool applyJobOption(const char* flag, FocusOptions& options, int& windowSize);
+
+/**
+ * @brief Reads a job in the syntax of a manifest line
+ * @param text The line
+ * @param options Options of the batch (defaults of the job)
+ * @param job Receives the job (its folder is left empty for an empty line or a comment)
+ * @param error Receives what is wrong with the line, if anything
+ * @return false if the line is not a valid job
+ */
+bool parseBatchJob(const std::string& text, const BatchOptions& options, BatchJob& job, std::string& error);
+
+/**
+ * @brief Lists the layers of a stack: the image files of its folder, in name order
+ * @param folder The folder
+ * @param paths Receives the paths of the files
+ * @return false if the folder can't be read or holds no image file
+ */
+bool listStackFiles(const std::string& folder, std::vector<std::string>& paths);
+
+/**
+ * @brief Reads the jobs of a manifest
+ *
+ * Every line is checked before any job runs; each bad line is reported.
+ * @param options Options of the batch (path to the manifest, defaults of the jobs)
+ * @param jobs Receives the jobs
+ * @return false if the manifest can't be read or has bad lines
+ */
+bool readBatchManifest(const BatchOptions& options, std::vector<BatchJob>& jobs);
+
+/**
+ * @brief Starts the threads of a back-end on the stack of a job, as Version1 does
+ * @param backend The back-end (its wait returns once the stack is focused)
+ * @param ctx Context of the job, with its number of threads set
+ */
+void startJobFocus(ThreadBackend* backend, FocusContext* ctx);
+
+/**
+ * @brief Runs the jobs through the load, focus and write pipeline
+ *
+ * Reports each job on stderr as its output is written, then the statistics
+ * of the whole batch.
+ * @param options Options of the batch
+ * @param jobs The jobs
+ * @return Number of jobs that failed
+ */
+unsigned int runBatch(const BatchOptions& options, std::vector<BatchJob>& jobs);
+
+#endif // FOCUS_BATCH_H
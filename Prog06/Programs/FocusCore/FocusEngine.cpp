@@ -0,0 +1,655 @@
+/**
+ * @file FocusEngine.cpp
+ * @brief The focus-stacking engine shared by the six programs
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include "FocusEngine.h"
+#include "ImageIO.h"
+#include "Checkpoint.h"
+#include "FocusMapCache.h"
+#include "FocusStats.h"
+#include "ThreadTuning.h"
+
+/** @brief Largest number of focusing threads accepted on the command line. */
+static const long MAX_THREADS = 4096;
+
+/** @brief Target size of the float accumulators of a block of blended rows, in bytes. */
+static const size_t BLEND_BLOCK_BYTES = 256 * 1024;
+
+/** @brief Most rows in a block of blended rows. */
+static const size_t MAX_BLEND_BLOCK_ROWS = 64;
+
+/** @brief Added to every blending weight, so that where no layer has contrast the layers are averaged. */
+static const float BLEND_EPSILON = 1.0e-3f;
+
+bool parseRegionSpec(const char* spec, ImageRegion& region) {
+	//	<width>x<height>+<x>+<y>, from the top left corner, as in image tools
+	char trailing;
+	return sscanf(spec, "%ux%u+%u+%u%c", &region.width, &region.height, &region.x, &region.y, &trailing) == 4 &&
+		   region.width > 0 && region.height > 0;
+}
+
+bool parseFocusOptions(int argc, char** argv, FocusOptions& options) {
+	//	Pull the "--" options out of the argument list
+	std::vector<char*> args;
+	bool badOption = false;
+	for (int i = 0; i < argc; i++) {
+		if (strncmp(argv[i], "--stats=", 8) == 0)
+			options.statsPeriodMs = atoi(argv[i] + 8);
+		else if (strcmp(argv[i], "--stats-json") == 0)
+			options.statsJSON = true;
+		else if (strncmp(argv[i], "--fps=", 6) == 0)
+			options.maxFrameRate = atoi(argv[i] + 6);
+		else if (strncmp(argv[i], "--seed=", 7) == 0)
+			options.runSeed = strtoull(argv[i] + 7, NULL, 10);
+		else if (strncmp(argv[i], "--lock-grid=", 12) == 0) {
+			int rows, cols;
+			options.lockGridSpec = argv[i] + 12;
+			badOption |= !parseLockGridSpec(options.lockGridSpec, rows, cols);
+		}
+		else if (strncmp(argv[i], "--backend=", 10) == 0)
+			options.backendName = argv[i] + 10;
+		else if (strcmp(argv[i], "--pin") == 0)
+			options.pinThreads = true;
+		else if (strcmp(argv[i], "--recalibrate") == 0)
+			options.recalibrate = true;
+		else if (strcmp(argv[i], "--rle") == 0)
+			options.compressOutput = true;
+		else if (strcmp(argv[i], "--blend") == 0)
+			options.blend = true;
+		else if (strncmp(argv[i], "--checkpoint=", 13) == 0)
+			options.checkpointPeriodS = atoi(argv[i] + 13);
+		else if (strncmp(argv[i], "--checkpoint-coverage=", 22) == 0)
+			options.checkpointCoveragePercent = atoi(argv[i] + 22);
+		else if (strcmp(argv[i], "--resume") == 0)
+			options.resume = true;
+		else if (strncmp(argv[i], "--roi=", 6) == 0)
+			badOption |= !parseRegionSpec(argv[i] + 6, options.roi);
+		else if (strncmp(argv[i], "--map-cache=", 12) == 0)
+			options.mapCacheDir = argv[i] + 12;
+		else if (strcmp(argv[i], "--order=random") == 0)
+			options.progressiveSampling = false;
+		else if (strcmp(argv[i], "--order=progressive") == 0)
+			options.progressiveSampling = true;
+		else
+			args.push_back(argv[i]);
+	}
+	if (options.statsJSON && options.statsPeriodMs == 0)
+		options.statsPeriodMs = 1000;
+
+	//	The number of threads is "auto" or a positive integer
+	char* end = NULL;
+	long numThreads = (args.size() < 4) ? 0 : strtol(args[1], &end, 10);
+	bool autoThreads = (args.size() >= 4 && strcmp(args[1], "auto") == 0);
+	if (badOption || args.size() < 4 || (!autoThreads && (*end != '\0' || numThreads < 1 || numThreads > MAX_THREADS))) {
+		fprintf(stderr, "Usage: %s [--stats=<ms>] [--stats-json] [--fps=<n>] [--order=progressive|random] "
+				"[--seed=<n>] [--lock-grid=<rows>x<cols>] [--backend=<name>] [--pin] [--recalibrate] [--rle] [--blend] "
+				"[--checkpoint=<s>] [--checkpoint-coverage=<%%>] [--resume] [--roi=<w>x<h>+<x>+<y>] [--map-cache=<dir>] <num_threads>|auto <output_path> <input_path>...\n"
+				"Back-ends: %s\n", argv[0], availableThreadBackends());
+		return false;
+	}
+
+	options.numThreads = autoThreads ? 0 : (unsigned int) numThreads;
+	options.outputPath = args[2];
+	options.inputPaths.assign(args.begin() + 3, args.end());
+	return true;
+}
+
+/**
+ * @brief Places the threads node by node (the rows they work on are placed by the threads, see placeThreadRows)
+ * @param ctx Context of the run
+ */
+static void placeFocusThreads(FocusContext* ctx) {
+	CpuTopology topology = readCpuTopology();
+	ctx->placement = placeThreads(topology, ctx->options.numThreads);
+	fprintf(stderr, "Pinned %u threads over %zu NUMA node(s)\n", ctx->options.numThreads, topology.nodes.size());
+}
+
+/**
+ * @brief Pins the calling thread, and moves the rows it works on to its NUMA node (with --pin)
+ *
+ * Called by the workers with the rows they were actually given, so the rows
+ * follow whatever split the program (or a shard) made.
+ * @param ctx Context of the run
+ * @param threadIndex Index of the thread
+ * @param startRow First row the thread works on
+ * @param endRow Row past the last one (startRow to leave the memory in place)
+ */
+static void placeThreadRows(FocusContext* ctx, unsigned int threadIndex, int startRow, int endRow) {
+	if (ctx->placement.empty())
+		return;
+	const ThreadPlacement& place = ctx->placement[threadIndex];
+	pinCurrentThread(place.cpu);
+
+	bool placed = true;
+	std::vector<RasterImage*> images = ctx->imageStack;
+	images.push_back(ctx->imageOut);
+	for (RasterImage* image : images) {
+		//	A view of a file is in the page cache, shared with other processes
+		if (!image->ownsRaster || endRow <= startRow)
+			continue;
+		unsigned char* rows = (unsigned char*) image->raster + (size_t) startRow * image->bytesPerRow;
+		placed &= placeMemoryOnNode(rows, (size_t) (endRow - startRow) * image->bytesPerRow, place.node);
+	}
+	if (!placed && !ctx->rowsNotPlaced.exchange(true))
+		fprintf(stderr, "Could not move the images to the NUMA nodes of the threads\n");
+}
+
+int checkFocusStack(const std::vector<RasterImage*>& layers, const std::string& outputPath, std::string& message) {
+	const RasterImage* first = layers[0];
+	for (const RasterImage* layer : layers) {
+		if (layer->width != first->width || layer->height != first->height || layer->type != first->type) {
+			message = "All the layers of the stack must have the same size and type";
+			return 13;
+		}
+		//	The output keeps the maximum value of the layers (the largest sample
+		//	allowed in its PGM header), so they must all have the same
+		if (first->type == DEEP_GRAY_RASTER && layer->maxVal != first->maxVal) {
+			message = "All the 16-bit layers of the stack must have the same maximum value";
+			return 13;
+		}
+	}
+
+	//	Only PGM files hold more than 8 bits per sample
+	ImageFileType outputType = imageFileType(outputPath.c_str());
+	if (first->type == DEEP_GRAY_RASTER && outputType != kPGM) {
+		message = "A stack of 16-bit images must be written to a .pgm file";
+		return 17;
+	}
+	return 0;
+}
+
+FocusContext* createFocusContext(const FocusOptions& options, int windowSize, const std::vector<RasterImage*>& layers) {
+	FocusContext* ctx = new FocusContext;
+	ctx->options = options;
+	ctx->windowSize = windowSize;
+	ctx->imageStack = layers;
+
+	const RasterImage* first = layers[0];
+	ctx->imageOut = new RasterImage(first->width, first->height, first->type);
+	ctx->imageOut->maxVal = first->maxVal;
+	ctx->coverage = new CoverageMap(ctx->imageOut->width, ctx->imageOut->height, windowSize);
+	if (!options.mapCacheDir.empty())
+		ctx->focusMaps = openFocusMaps(options.mapCacheDir, layers, windowSize);
+	return ctx;
+}
+
+FocusContext* loadFocusStack(const FocusOptions& options, int windowSize, std::string* error) {
+	//	Load the image stack, or its region of interest (readImage exits if a
+	//	layer can't be read or doesn't contain the region, unless the caller
+	//	asked for the error)
+	std::vector<RasterImage*> layers;
+	const ImageRegion* region = (options.roi.width > 0) ? &options.roi : nullptr;
+	std::string message;
+	int status = 0;
+	for (const auto& filePath : options.inputPaths) {
+		RasterImage* layer = readImage(filePath.c_str(), region, error);
+		if (layer == nullptr) {
+			status = -1;
+			break;
+		}
+		layers.push_back(layer);
+	}
+	if (status == 0 && (status = checkFocusStack(layers, options.outputPath, message)) != 0) {
+		if (error == nullptr) {
+			fprintf(stderr, "%s\n", message.c_str());
+			exit(status);
+		}
+		*error = message;
+	}
+	if (status != 0) {
+		for (RasterImage* layer : layers)
+			delete layer;
+		return nullptr;
+	}
+	return createFocusContext(options, windowSize, layers);
+}
+
+FocusContext* initializeFocus(const FocusOptions& options, int windowSize) {
+	FocusContext* ctx = loadFocusStack(options, windowSize);
+	if (ctx->options.numThreads == 0)
+		ctx->options.numThreads = autotuneThreads(ctx, options.recalibrate);
+#ifndef FOCUS_HEADLESS
+	ctx->displaySnapshot = new DisplaySnapshot(ctx->imageOut);
+#endif
+	if (options.pinThreads)
+		placeFocusThreads(ctx);
+	if (options.resume)
+		resumeFromCheckpoint(ctx);
+	if (options.resume || options.checkpointPeriodS > 0 || options.checkpointCoveragePercent > 0) {
+		ctx->checkpointWriter = new CheckpointWriter(ctx);
+		ctx->checkpointWriter->start();
+	}
+
+	initializeStats(ctx->options.numThreads);
+	if (options.statsPeriodMs > 0)
+		startStatsReporter(options.statsPeriodMs, options.statsJSON);
+
+	return ctx;
+}
+
+void releaseFocusContext(FocusContext* ctx) {
+	delete ctx->checkpointWriter;
+	delete ctx->locking;
+	delete ctx->displaySnapshot;
+	delete ctx->coverage;
+	delete ctx->imageOut;
+	delete ctx->depthMap;
+	for (FocusMap* map : ctx->focusMaps)
+		delete map;
+	for (RasterImage* layer : ctx->imageStack)
+		delete layer;
+	delete ctx;
+}
+
+void threadRowBand(const FocusContext* ctx, unsigned int threadIndex, int& startRow, int& endRow) {
+	int rowsPerThread = ctx->imageOut->height / ctx->options.numThreads;
+	startRow = threadIndex * rowsPerThread;
+	endRow = (threadIndex == ctx->options.numThreads - 1) ? ctx->imageOut->height : startRow + rowsPerThread;
+}
+
+double convertToGrayscale(const RasterImage* image, int row, int col) {
+	if (image->type == RGBA32_RASTER) {
+		const unsigned char* const* raster2D = (const unsigned char* const*) image->raster2D;
+		const unsigned char* pixel = raster2D[row] + col * 4;
+
+		// Average of RGB values
+		return (pixel[0] + pixel[1] + pixel[2]) / 3.0;
+	}
+	else if (image->type == GRAY_RASTER) {
+		const unsigned char* const* raster2D = (const unsigned char* const*) image->raster2D;
+		return raster2D[row][col];
+	}
+	else if (image->type == DEEP_GRAY_RASTER) {
+		const unsigned short* const* raster2D = (const unsigned short* const*) image->raster2D;
+		return raster2D[row][col];
+	}
+	return 0;
+}
+
+void copyPixel(const RasterImage* srcImage, RasterImage* dstImage, int row, int col) {
+	if (srcImage->type == RGBA32_RASTER && dstImage->type == RGBA32_RASTER) {
+		const unsigned char* const* srcRaster2D = (const unsigned char* const*) srcImage->raster2D;
+		unsigned char** dstRaster2D = (unsigned char**) dstImage->raster2D;
+
+		for (int i = 0; i < 4; i++) { // Copy RGBA channels
+			dstRaster2D[row][col * 4 + i] = srcRaster2D[row][col * 4 + i];
+		}
+	}
+	else if (srcImage->type == GRAY_RASTER && dstImage->type == GRAY_RASTER) {
+		const unsigned char* const* srcRaster2D = (const unsigned char* const*) srcImage->raster2D;
+		unsigned char** dstRaster2D = (unsigned char**) dstImage->raster2D;
+
+		dstRaster2D[row][col] = srcRaster2D[row][col];
+	}
+	else if (srcImage->type == DEEP_GRAY_RASTER && dstImage->type == DEEP_GRAY_RASTER) {
+		const unsigned short* const* srcRaster2D = (const unsigned short* const*) srcImage->raster2D;
+		unsigned short** dstRaster2D = (unsigned short**) dstImage->raster2D;
+
+		dstRaster2D[row][col] = srcRaster2D[row][col];
+	}
+}
+
+double calculateWindowContrast(const RasterImage* image, int centerRow, int centerCol, int windowSize) {
+	// (16-bit gray levels go past 255)
+	double minGray = std::numeric_limits<double>::max(), maxGray = 0.0;
+
+	// Loop over the window centered at (centerRow, centerCol)
+	for (int i = -windowSize / 2; i <= windowSize / 2; i++) {
+		for (int j = -windowSize / 2; j <= windowSize / 2; j++) {
+			unsigned int currentRow = centerRow + i;
+			unsigned int currentCol = centerCol + j;
+
+			// Check bounds (a negative index wraps around to a large unsigned one)
+			if (currentRow < image->height && currentCol < image->width) {
+				double gray = convertToGrayscale(image, currentRow, currentCol);
+				minGray = std::min(minGray, gray);
+				maxGray = std::max(maxGray, gray);
+			}
+		}
+	}
+
+	return maxGray - minGray; // Contrast is the range of grayscale values
+}
+
+/**
+ * @brief Level of a layer in the depth map
+ * @param layerIndex Index of the layer (or mean index, with --blend)
+ * @param numLayers Number of layers of the stack
+ * @return From 0 for the first layer to 255 for the last one
+ */
+static inline unsigned char depthLevel(float layerIndex, size_t numLayers) {
+	return (numLayers > 1) ? (unsigned char) (layerIndex * 255.0f / (numLayers - 1) + 0.5f) : 0;
+}
+
+/**
+ * @brief Finds the layer with the most contrast in a window
+ * @param ctx Context of the run (its layers, and their focus maps if there are any)
+ * @param centerRow Middle row of the window
+ * @param centerCol Middle column of the window
+ * @return Index of the layer (-1 for an empty stack)
+ */
+static int bestLayer(const FocusContext* ctx, int centerRow, int centerCol) {
+	const std::vector<RasterImage*>& imageStack = ctx->imageStack;
+	const bool withMaps = !ctx->focusMaps.empty();
+	double highestContrast = -1.0;
+	int bestImageIndex = -1;
+	for (size_t imgIndex = 0; imgIndex < imageStack.size(); ++imgIndex) {
+		double contrast = withMaps ? ctx->focusMaps[imgIndex]->windowContrast(centerRow, centerCol) :
+						  calculateWindowContrast(imageStack[imgIndex], centerRow, centerCol, ctx->windowSize);
+		if (contrast > highestContrast) {
+			highestContrast = contrast;
+			bestImageIndex = imgIndex;
+		}
+	}
+	return bestImageIndex;
+}
+
+void focusPixelRows(FocusContext* ctx, int startRow, int endRow, unsigned int threadIndex) {
+	RasterImage* outputImage = ctx->imageOut;
+	placeThreadRows(ctx, threadIndex, startRow, endRow);
+	ThreadStats* stats = getThreadStats(threadIndex);
+	statsThreadStarted(stats);
+
+	// Best image of each pixel of the current row, so the row is written in one burst
+	std::vector<int> bestImageIndices(outputImage->width);
+
+	for (int row = startRow; row < endRow; ++row) {
+		if (ctx->coverage->isRowCovered(row))
+			continue;
+		for (unsigned int col = 0; col < outputImage->width; ++col) {
+			bestImageIndices[col] = bestLayer(ctx, row, col);
+			stats->windowsProcessed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		unsigned int numWritten = 0;
+		if (ctx->displaySnapshot != nullptr)
+			ctx->displaySnapshot->beginWrite(row, row, 0, outputImage->width - 1);
+		for (unsigned int col = 0; col < outputImage->width; ++col) {
+			if (bestImageIndices[col] != -1) {
+				copyPixel(ctx->imageStack[bestImageIndices[col]], outputImage, row, col);
+				numWritten++;
+			}
+		}
+		if (ctx->displaySnapshot != nullptr)
+			ctx->displaySnapshot->endWrite(row, row, 0, outputImage->width - 1);
+		if (ctx->depthMap != nullptr) {
+			unsigned char* depth = ((unsigned char**) ctx->depthMap->raster2D)[row];
+			for (unsigned int col = 0; col < outputImage->width; ++col)
+				depth[col] = depthLevel(bestImageIndices[col], ctx->imageStack.size());
+		}
+		// Counted once the row is complete: the GUI redraws when this count moves
+		stats->pixelsWritten.fetch_add(numWritten, std::memory_order_relaxed);
+		ctx->coverage->markCovered(row, row, 0, outputImage->width - 1);
+	}
+
+	statsThreadFinished(stats);
+	ctx->numFinishedThreads.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Reads the gray levels of a row of a layer (as convertToGrayscale does), padded by replicating its ends
+ * @param image The layer
+ * @param row The row
+ * @param pad Number of values added at each end
+ * @param gray Receives width + 2 * pad gray levels
+ */
+static void readPaddedGrayRow(const RasterImage* image, int row, int pad, float* gray) {
+	const int width = image->width;
+	if (image->type == RGBA32_RASTER) {
+		const unsigned char* pixels = ((const unsigned char* const*) image->raster2D)[row];
+		for (int col = 0; col < width; col++)
+			gray[pad + col] = (pixels[4 * col] + pixels[4 * col + 1] + pixels[4 * col + 2]) / 3.0f;
+	}
+	else if (image->type == GRAY_RASTER) {
+		const unsigned char* pixels = ((const unsigned char* const*) image->raster2D)[row];
+		for (int col = 0; col < width; col++)
+			gray[pad + col] = pixels[col];
+	}
+	else {
+		const unsigned short* pixels = ((const unsigned short* const*) image->raster2D)[row];
+		for (int col = 0; col < width; col++)
+			gray[pad + col] = pixels[col];
+	}
+	//	Over a window clipped to the image, the min and max are those of the replicated edge
+	std::fill(gray, gray + pad, gray[pad]);
+	std::fill(gray + pad + width, gray + 2 * pad + width, gray[pad + width - 1]);
+}
+
+/**
+ * @brief Reads one channel of a row of a layer as floats
+ * @param image The layer
+ * @param row The row
+ * @param channel The channel (0 to 2 for a color layer, 0 for a gray one)
+ * @param values Receives width values
+ */
+static void readChannelRow(const RasterImage* image, int row, int channel, float* values) {
+	const int width = image->width;
+	if (image->type == RGBA32_RASTER) {
+		const unsigned char* pixels = ((const unsigned char* const*) image->raster2D)[row];
+		for (int col = 0; col < width; col++)
+			values[col] = pixels[4 * col + channel];
+	}
+	else if (image->type == GRAY_RASTER) {
+		const unsigned char* pixels = ((const unsigned char* const*) image->raster2D)[row];
+		for (int col = 0; col < width; col++)
+			values[col] = pixels[col];
+	}
+	else {
+		const unsigned short* pixels = ((const unsigned short* const*) image->raster2D)[row];
+		for (int col = 0; col < width; col++)
+			values[col] = pixels[col];
+	}
+}
+
+void blendPixelRows(FocusContext* ctx, int startRow, int endRow, unsigned int threadIndex) {
+	RasterImage* outputImage = ctx->imageOut;
+	const int width = outputImage->width;
+	const int height = outputImage->height;
+	const int halfWindow = ctx->windowSize / 2;
+	const int numChannels = (outputImage->type == RGBA32_RASTER) ? 3 : 1;
+	placeThreadRows(ctx, threadIndex, startRow, endRow);
+	ThreadStats* stats = getThreadStats(threadIndex);
+	statsThreadStarted(stats);
+
+	//	Accumulators of a block: the sum of the weights, and the weighted sums
+	//	of the channels, one after the other in each row
+	const int blockRows = (int) std::clamp<size_t>(BLEND_BLOCK_BYTES / ((size_t) width * (numChannels + 1) * sizeof(float)),
+												   1, MAX_BLEND_BLOCK_ROWS);
+	RasterImage weightSums(width, blockRows, FLOAT_RASTER);
+	RasterImage channelSums(width * numChannels, blockRows, FLOAT_RASTER);
+	float** weightRows = (float**) weightSums.raster2D;
+	float** channelRows = (float**) channelSums.raster2D;
+	//	With a depth map, the weighted sum of the layer indices
+	std::vector<float> depthSums(ctx->depthMap != nullptr ? (size_t) blockRows * width : 0);
+
+	//	Gray levels, then their min and max along the rows, of the block and the half windows around it
+	const int paddedWidth = width + 2 * halfWindow;
+	std::vector<float> gray(paddedWidth);
+	std::vector<float> rowMin((size_t) (blockRows + 2 * halfWindow) * width);
+	std::vector<float> rowMax(rowMin.size());
+	std::vector<float> contrastMin(width), contrastMax(width), weights(width), values(width);
+
+	for (int blockStart = startRow; blockStart < endRow; blockStart += blockRows) {
+		const int blockEnd = std::min(blockStart + blockRows, endRow);
+		int numCovered = 0;
+		for (int row = blockStart; row < blockEnd; row++)
+			numCovered += ctx->coverage->isRowCovered(row);
+		if (numCovered == blockEnd - blockStart)
+			continue;
+		const int firstRow = std::max(blockStart - halfWindow, 0);
+		const int lastRow = std::min(blockEnd + halfWindow, height);
+		for (int r = 0; r < blockEnd - blockStart; r++) {
+			std::fill_n(weightRows[r], width, 0.0f);
+			std::fill_n(channelRows[r], width * numChannels, 0.0f);
+		}
+		std::fill(depthSums.begin(), depthSums.end(), 0.0f);
+
+		for (size_t layerIndex = 0; layerIndex < ctx->imageStack.size(); layerIndex++) {
+			const RasterImage* layer = ctx->imageStack[layerIndex];
+			const FocusMap* map = ctx->focusMaps.empty() ? nullptr : ctx->focusMaps[layerIndex];
+			//	Min and max of each row over the width of the window (a focus map already has them over the window)
+			for (int row = firstRow; map == nullptr && row < lastRow; row++) {
+				readPaddedGrayRow(layer, row, halfWindow, gray.data());
+				float* minOut = rowMin.data() + (size_t) (row - firstRow) * width;
+				float* maxOut = rowMax.data() + (size_t) (row - firstRow) * width;
+				std::copy_n(gray.data(), width, minOut);
+				std::copy_n(gray.data(), width, maxOut);
+				for (int k = 1; k <= 2 * halfWindow; k++) {
+					const float* shifted = gray.data() + k;
+					for (int col = 0; col < width; col++) {
+						minOut[col] = std::min(minOut[col], shifted[col]);
+						maxOut[col] = std::max(maxOut[col], shifted[col]);
+					}
+				}
+			}
+
+			//	Then over the height of the window, and accumulate
+			for (int row = blockStart; row < blockEnd; row++) {
+				const int windowFirst = std::max(row - halfWindow, 0) - firstRow;
+				const int windowLast = std::min(row + halfWindow, height - 1) - firstRow;
+				if (map != nullptr)
+					map->grayRanges(row, contrastMin.data(), contrastMax.data());
+				else {
+					std::copy_n(rowMin.data() + (size_t) windowFirst * width, width, contrastMin.data());
+					std::copy_n(rowMax.data() + (size_t) windowFirst * width, width, contrastMax.data());
+				}
+				for (int r = windowFirst + 1; map == nullptr && r <= windowLast; r++) {
+					const float* minIn = rowMin.data() + (size_t) r * width;
+					const float* maxIn = rowMax.data() + (size_t) r * width;
+					for (int col = 0; col < width; col++) {
+						contrastMin[col] = std::min(contrastMin[col], minIn[col]);
+						contrastMax[col] = std::max(contrastMax[col], maxIn[col]);
+					}
+				}
+
+				float* weightSum = weightRows[row - blockStart];
+				for (int col = 0; col < width; col++) {
+					float contrast = contrastMax[col] - contrastMin[col];
+					weights[col] = std::fma(contrast, contrast, BLEND_EPSILON);
+					weightSum[col] += weights[col];
+				}
+				for (int channel = 0; channel < numChannels; channel++) {
+					readChannelRow(layer, row, channel, values.data());
+					float* channelSum = channelRows[row - blockStart] + channel * width;
+					for (int col = 0; col < width; col++)
+						channelSum[col] = std::fma(weights[col], values[col], channelSum[col]);
+				}
+				if (!depthSums.empty()) {
+					float* depthSum = depthSums.data() + (size_t) (row - blockStart) * width;
+					for (int col = 0; col < width; col++)
+						depthSum[col] = std::fma(weights[col], (float) layerIndex, depthSum[col]);
+				}
+			}
+		}
+		stats->windowsProcessed.fetch_add((blockEnd - blockStart) * width, std::memory_order_relaxed);
+
+		//	Normalize the block into the output
+		if (ctx->displaySnapshot != nullptr)
+			ctx->displaySnapshot->beginWrite(blockStart, blockEnd - 1, 0, width - 1);
+		const float maxValue = outputImage->maxVal;
+		for (int row = blockStart; row < blockEnd; row++) {
+			const float* weightSum = weightRows[row - blockStart];
+			for (int channel = 0; channel < numChannels; channel++) {
+				const float* channelSum = channelRows[row - blockStart] + channel * width;
+				for (int col = 0; col < width; col++)
+					values[col] = std::min(channelSum[col] / weightSum[col] + 0.5f, maxValue);
+				if (outputImage->type == RGBA32_RASTER) {
+					unsigned char* pixels = ((unsigned char**) outputImage->raster2D)[row];
+					for (int col = 0; col < width; col++)
+						pixels[4 * col + channel] = (unsigned char) values[col];
+				}
+				else if (outputImage->type == GRAY_RASTER) {
+					unsigned char* pixels = ((unsigned char**) outputImage->raster2D)[row];
+					for (int col = 0; col < width; col++)
+						pixels[col] = (unsigned char) values[col];
+				}
+				else {
+					unsigned short* pixels = ((unsigned short**) outputImage->raster2D)[row];
+					for (int col = 0; col < width; col++)
+						pixels[col] = (unsigned short) values[col];
+				}
+			}
+			if (!depthSums.empty()) {
+				const float* depthSum = depthSums.data() + (size_t) (row - blockStart) * width;
+				unsigned char* depth = ((unsigned char**) ctx->depthMap->raster2D)[row];
+				for (int col = 0; col < width; col++)
+					depth[col] = depthLevel(depthSum[col] / weightSum[col], ctx->imageStack.size());
+			}
+		}
+		if (ctx->displaySnapshot != nullptr)
+			ctx->displaySnapshot->endWrite(blockStart, blockEnd - 1, 0, width - 1);
+		stats->pixelsWritten.fetch_add((blockEnd - blockStart) * width, std::memory_order_relaxed);
+		ctx->coverage->markCovered(blockStart, blockEnd - 1, 0, width - 1);
+	}
+
+	statsThreadFinished(stats);
+	ctx->numFinishedThreads.fetch_add(1, std::memory_order_release);
+}
+
+void focusWindowTiles(FocusContext* ctx, std::vector<unsigned int> tiles, unsigned int threadIndex) {
+	RasterImage* outputImage = ctx->imageOut;
+
+	//	The rows of the tiles are this thread's only if it has every tile of
+	//	them (a band of tile rows, Version3), not an interleaved slice (Version2)
+	if (!ctx->placement.empty()) {
+		const CoverageMap* coverage = ctx->coverage;
+		unsigned int firstTileRow = coverage->tilesY, lastTileRow = 0;
+		for (unsigned int tile : tiles) {
+			firstTileRow = std::min(firstTileRow, tile / coverage->tilesX);
+			lastTileRow = std::max(lastTileRow, tile / coverage->tilesX);
+		}
+		bool wholeRows = !tiles.empty() && tiles.size() == (size_t) (lastTileRow - firstTileRow + 1) * coverage->tilesX;
+		int startRow = firstTileRow * coverage->tileSize;
+		int endRow = std::min((lastTileRow + 1) * coverage->tileSize, coverage->height);
+		placeThreadRows(ctx, threadIndex, startRow, wholeRows ? endRow : startRow);
+	}
+	ThreadStats* stats = getThreadStats(threadIndex);
+	statsThreadStarted(stats);
+	FastRandom generator(ctx->options.runSeed, threadIndex);
+	TileSampler sampler(ctx->coverage, std::move(tiles), ctx->options.progressiveSampling);
+	HeldLocks held;
+	unsigned int tileIndex;
+	int centerRow, centerCol;
+
+	// Each window covers one uncovered tile; stop once all of ours are covered
+	while (sampler.nextWindow(generator, tileIndex, centerRow, centerCol)) {
+
+		// Find the best image (reads only, no lock needed; the stack is never empty)
+		int bestImageIndex = bestLayer(ctx, centerRow, centerCol);
+		stats->windowsProcessed.fetch_add(1, std::memory_order_relaxed);
+
+		// Only the pixels of the tile are written: the window of a tile at the
+		// right or bottom edge reaches into tiles other threads own
+		int rowMin, rowMax, colMin, colMax;
+		ctx->coverage->tileBounds(tileIndex, rowMin, rowMax, colMin, colMax);
+
+		// Write the tile from the best image.  No other thread writes it, so
+		// the locks guard nothing: they are taken to demonstrate locking only
+		ctx->locking->lock(rowMin, rowMax, colMin, colMax, stats, held);
+		if (ctx->displaySnapshot != nullptr)
+			ctx->displaySnapshot->beginWrite(rowMin, rowMax, colMin, colMax);
+		for (int row = rowMin; row <= rowMax; ++row) {
+			for (int col = colMin; col <= colMax; ++col) {
+				copyPixel(ctx->imageStack[bestImageIndex], outputImage, row, col);
+			}
+		}
+		if (ctx->displaySnapshot != nullptr)
+			ctx->displaySnapshot->endWrite(rowMin, rowMax, colMin, colMax);
+		stats->pixelsWritten.fetch_add((rowMax - rowMin + 1) * (colMax - colMin + 1), std::memory_order_relaxed);
+		ctx->coverage->markCovered(rowMin, rowMax, colMin, colMax);
+		ctx->locking->unlock(stats, held);
+	}
+
+	statsThreadFinished(stats);
+	ctx->numFinishedThreads.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,326 @@
+/**
+ * @file FocusEngine.h
+ * @brief The focus-stacking engine shared by the six programs
+ *
+ * The programs differ only in how they split the work between threads and
+ * how they lock the output image; everything else is here: the options,
+ * the loading of the stack, the contrast kernel and the two kinds of worker.
+ *
+ *	- focusPixelRows: every pixel of a band of rows takes the pixel of the
+ *	  layer with the most contrast around it (Version1, no locking needed).
+ *	- focusWindowTiles: each uncovered coverage tile takes its pixels from the
+ *	  layer with the most contrast in the window centered on it (Versions 2
+ *	  and 3).  A thread writes only its own tiles, so the output doesn't
+ *	  depend on the thread schedule and no two threads write the same pixel:
+ *	  the locking policy of the context guards no shared data, and is only
+ *	  there to demonstrate locking (see WindowLocking.h).
+ *	- blendPixelRows: every pixel of a band of rows is a contrast-weighted
+ *	  average of the layers (--blend, all versions).
+ *
+ * Pixels already covered (restored from a checkpoint, see Checkpoint.h) are
+ * skipped by all three.  With --map-cache, all three read the contrasts from
+ * the focus maps of the layers (see FocusMapCache.h) instead of computing them.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef FOCUS_ENGINE_H
+#define FOCUS_ENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RasterImage.h"
+#include "CoverageMap.h"
+#include "DisplaySnapshot.h"
+#include "FastRandom.h"
+#include "WindowLocking.h"
+#include "ThreadBackend.h"
+#include "CpuTopology.h"
+
+class CheckpointWriter;
+class FocusMap;
+
+/**
+ * @struct FocusOptions
+ * @brief Command line of a focusing program.
+ *
+ * Every program accepts every option; one that doesn't apply to a version
+ * (e.g. --lock-grid for Version2) is ignored.
+ */
+struct FocusOptions {
+	/** @brief Number of focusing threads (0 for "auto": chosen by autotuneThreads once the stack is loaded). */
+	unsigned int numThreads = 1;
+
+	/** @brief With "auto", calibrate even if the host has a saved choice. */
+	bool recalibrate = false;
+
+	/** @brief Path to the output image file. */
+	std::string outputPath;
+
+	/** @brief If true, the output image is written run-length encoded. */
+	bool compressOutput = false;
+
+	/** @brief If true, every layer contributes to each pixel, weighted by its contrast (see blendPixelRows). */
+	bool blend = false;
+
+	/** @brief Period of the checkpoints of the output, in seconds (0: none). */
+	unsigned int checkpointPeriodS = 0;
+
+	/** @brief A checkpoint is also written each time this many more percent of the pixels are covered (0: none). */
+	unsigned int checkpointCoveragePercent = 0;
+
+	/** @brief If true, the run starts from the checkpoint of its output, if there is one. */
+	bool resume = false;
+
+	/** @brief Region of the layers to focus (--roi); the output is the size of the region (width 0: whole layers). */
+	ImageRegion roi;
+
+	/** @brief Directory of the cache of focus maps (--map-cache, see FocusMapCache.h), or empty for none. */
+	std::string mapCacheDir;
+
+	/** @brief Paths to the layers of the stack. */
+	std::vector<std::string> inputPaths;
+
+	/** @brief Period of the stderr statistics reporter, in milliseconds (0: off). */
+	unsigned int statsPeriodMs = 0;
+
+	/** @brief If true, the reporter writes JSON lines instead of text. */
+	bool statsJSON = false;
+
+	/** @brief Maximum number of frames drawn per second (0: front-end default). */
+	unsigned int maxFrameRate = 0;
+
+	/** @brief If true, tiles are processed in progressive (low-discrepancy) order, otherwise at random. */
+	bool progressiveSampling = true;
+
+	/** @brief Seed of the run: each thread seeds its generator from it and its index. */
+	uint64_t runSeed = DEFAULT_RUN_SEED;
+
+	/** @brief "RxC" to force the size of the lock grid, or nullptr to choose it automatically. */
+	const char* lockGridSpec = nullptr;
+
+	/** @brief Threading back-end to run the threads on, or nullptr for FOCUS_BACKEND or the program's default. */
+	const char* backendName = nullptr;
+
+	/** @brief If true, threads are pinned node by node and the rows each one works on placed on its node. */
+	bool pinThreads = false;
+};
+
+/**
+ * @struct FocusContext
+ * @brief Everything the workers and the front end share during a run.
+ */
+struct FocusContext {
+	/** @brief Options of the run (with the number of threads chosen, if it was "auto"). */
+	FocusOptions options;
+
+	/** @brief The layers of the stack. */
+	std::vector<RasterImage*> imageStack;
+
+	/** @brief The output image. */
+	RasterImage* imageOut = nullptr;
+
+	/** @brief Side of the square window examined around each pixel (also the coverage tile size). */
+	int windowSize = 0;
+
+	/**
+	 * @brief Depth map of the output: for each pixel, the layer it was taken from, from 0 (first
+	 * layer) to 255 (last layer), or the contrast-weighted mean layer with --blend (none unless the
+	 * program allocates it, a GRAY_RASTER the size of the output; only the row workers fill it).
+	 */
+	RasterImage* depthMap = nullptr;
+
+	/** @brief Focus map of each layer, the contrasts of its windows (empty without --map-cache). */
+	std::vector<FocusMap*> focusMaps;
+
+	/** @brief Record of the output pixels written so far. */
+	CoverageMap* coverage = nullptr;
+
+	/** @brief Tear-free copy of the output image, refreshed for each frame (none when headless). */
+	DisplaySnapshot* displaySnapshot = nullptr;
+
+	/** @brief Locking policy of the output image (none for Version1, a demonstration only for Versions 2 and 3, see WindowLocking.h). */
+	WindowLocking* locking = nullptr;
+
+	/** @brief Threading back-end the focusing threads run on. */
+	ThreadBackend* backend = nullptr;
+
+	/**
+	 * @brief CPU and node of each thread (empty when the threads aren't pinned).  Each worker
+	 * moves the rows it is given to its node as it starts, so they follow the split actually used.
+	 */
+	std::vector<ThreadPlacement> placement;
+
+	/** @brief Number of the run's workers that are done (the run is over once all of options.numThreads are). */
+	std::atomic<unsigned int> numFinishedThreads{0};
+
+	/** @brief Set once a worker failed to move its rows to its node (reported once). */
+	std::atomic<bool> rowsNotPlaced{false};
+
+	/** @brief Writer of the checkpoints and of the output (none without checkpoint options). */
+	CheckpointWriter* checkpointWriter = nullptr;
+};
+
+/**
+ * @brief Pulls the options out of the command line
+ *
+ * Prints the usage line if the command line is incomplete.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param options Receives the options
+ * @return false if the command line is incomplete
+ */
+bool parseFocusOptions(int argc, char** argv, FocusOptions& options);
+
+/**
+ * @brief Reads a region of interest given as <width>x<height>+<x>+<y> (see ImageRegion)
+ * @param spec The text, e.g. "1000x1000+2500+1800"
+ * @param region Receives the region
+ * @return false if the text isn't a non-empty region
+ */
+bool parseRegionSpec(const char* spec, ImageRegion& region);
+
+/**
+ * @brief Checks that the layers of a stack can be focused together, into an output file
+ * @param layers The layers (at least one)
+ * @param outputPath Path of the output
+ * @param message Receives the reason, if they can't
+ * @return 0 if they can, otherwise the exit code of the programs: 13 if the layers
+ *		   don't all have the same size and type (and, 16-bit ones, the same maximum value),
+ *		   17 for 16-bit layers and an output that isn't a PGM file
+ */
+int checkFocusStack(const std::vector<RasterImage*>& layers, const std::string& outputPath, std::string& message);
+
+/**
+ * @brief Creates the context of a run over layers already loaded (and checked with checkFocusStack)
+ *
+ * Allocates the output image and the coverage map, and opens the focus maps
+ * of the layers with --map-cache; the context owns the layers, unless its
+ * imageStack is cleared before releaseFocusContext.
+ * @param options Options of the run
+ * @param windowSize Side of the window examined around each pixel
+ * @param layers The layers
+ * @return The context of the run
+ */
+FocusContext* createFocusContext(const FocusOptions& options, int windowSize, const std::vector<RasterImage*>& layers);
+
+/**
+ * @brief Loads the stack, and allocates the output image and the coverage map
+ *
+ * The first part of initializeFocus, for programs that run the engine
+ * themselves (e.g. the batch driver, see FocusBatch.h): nothing is started,
+ * and the number of threads is left as it is in the options.  Exits if a
+ * layer can't be read or the layers don't make a stack (see checkFocusStack),
+ * unless the caller asks for the error.
+ * @param options Options of the run
+ * @param windowSize Side of the window examined around each pixel
+ * @param error If not nullptr, receives the message of an error instead of the program exiting
+ * @return The context of the run, or nullptr after an error reported in error
+ */
+FocusContext* loadFocusStack(const FocusOptions& options, int windowSize, std::string* error = nullptr);
+
+/**
+ * @brief Deletes a context and everything it owns (layers, focus maps, output image, depth map and companions, but not the back-end)
+ * @param ctx The context
+ */
+void releaseFocusContext(FocusContext* ctx);
+
+/**
+ * @brief Loads the stack and allocates the output image and its companions
+ *
+ * With --roi, only the region is read from each layer (a view of the file
+ * where possible, see readImage), and the output is the region alone: the
+ * windows are clipped at its edges as they are at the edges of the layers.
+ * Chooses the number of threads if it is "auto" (see ThreadTuning.h), then
+ * starts the statistics (and their reporter, if requested).  Exits if
+ * a layer can't be read or the layers don't all have the same size and type.
+ * With --resume, the output starts from its checkpoint; with checkpoint
+ * options (or --resume), the checkpoint writer is started.
+ * With --pin, the threads are placed node by node (see placeThreads); each
+ * worker then moves the rows of the stack and of the output it was given to
+ * its node as it starts, so that a band is read from local memory whatever
+ * split the program (or a shard) made.  This helps the band-based workers;
+ * the interleaved slices of Version2 have no locality to exploit, and their
+ * rows stay where they are.
+ * @param options Options of the run
+ * @param windowSize Side of the window examined around each pixel
+ * @return The context of the run (without a locking policy or back-end: the program sets them)
+ */
+FocusContext* initializeFocus(const FocusOptions& options, int windowSize);
+
+/**
+ * @brief Computes the rows of the band of a thread, when the image is split in equal bands
+ * @param ctx Context of the run
+ * @param threadIndex Index of the thread
+ * @param startRow Receives the first row of the band
+ * @param endRow Receives the row past the end of the band
+ */
+void threadRowBand(const FocusContext* ctx, unsigned int threadIndex, int& startRow, int& endRow);
+
+/**
+ * @brief Function used to converts a pixel to its gray scale value
+ * @param image Image to read from
+ * @param row Row of the pixel to convert
+ * @param col Column of the pixel to convert
+ * @return Gray level of the pixel
+ */
+double convertToGrayscale(const RasterImage* image, int row, int col);
+
+/**
+ * @brief Function used to Write the best pixel to the Output Image
+ * @param srcImage pointer to the image to copy from
+ * @param dstImage Pointer to the image to write to
+ * @param row Row of the pixel to write to
+ * @param col Column of the pixel to write to
+ */
+void copyPixel(const RasterImage* srcImage, RasterImage* dstImage, int row, int col);
+
+/**
+ * @brief Function used to calculate the windows contrast
+ * @param image Pointer to the image to consider
+ * @param centerRow Stores the middle row of the Window
+ * @param centerCol Stores the middle collumn of the window
+ * @param windowSize Stores the size of the window to examine
+ * @return Contrast (range of the gray levels in the window)
+ */
+double calculateWindowContrast(const RasterImage* image, int centerRow, int centerCol, int windowSize);
+
+/**
+ * @brief Work of a thread focusing pixel by pixel over a band of rows
+ * @param ctx Context of the run
+ * @param startRow Stores the Start Row for that thread
+ * @param endRow Stores the end Row for that thread
+ * @param threadIndex Index of the thread (selects its counters)
+ */
+void focusPixelRows(FocusContext* ctx, int startRow, int endRow, unsigned int threadIndex);
+
+/**
+ * @brief Work of a thread blending the layers over a band of rows (--blend)
+ *
+ * Instead of copying each pixel from the layer with the most contrast, every
+ * layer contributes to it with a weight of its squared window contrast, so
+ * the transitions between layers have no seams.  The band is processed in
+ * blocks of rows small enough that their float accumulators (the sum of the
+ * weights, and the weighted sum of each channel) stay in cache while every
+ * layer is added in; the window contrasts are computed with separable
+ * min/max filters, and the accumulation with fused multiply-adds, in loops
+ * the compiler vectorizes.  Each block is then normalized into the output.
+ * @param ctx Context of the run
+ * @param startRow First row of the band
+ * @param endRow Row past the end of the band
+ * @param threadIndex Index of the thread (selects its counters)
+ */
+void blendPixelRows(FocusContext* ctx, int startRow, int endRow, unsigned int threadIndex);
+
+/**
+ * @brief Work of a thread focusing window by window over a set of coverage tiles
+ * @param ctx Context of the run (its locking policy is taken around the writes, as a demonstration)
+ * @param tiles Indices of the coverage tiles assigned to this thread
+ * @param threadIndex Index of the thread (selects its counters and seeds its generator)
+ */
+void focusWindowTiles(FocusContext* ctx, std::vector<unsigned int> tiles, unsigned int threadIndex);
+
+#endif // FOCUS_ENGINE_H
@@ -0,0 +1,398 @@
+/**
+ * @file FocusMapCache.cpp
+ * @brief Focus maps of the layers (the range of gray levels in the window around each pixel), cached on disk
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FocusMapCache.h"
+
+/** @brief Version of the map files (and of their keys): maps of other versions are never found. */
+static const uint32_t FOCUS_MAP_VERSION = 1;
+
+/** @brief First bytes of a map file. */
+static const char FOCUS_MAP_MAGIC[8] = {'F', 'O', 'C', 'U', 'S', 'M', 'A', 'P'};
+
+/** @brief Multipliers of the hash (those of xxHash64). */
+static const uint64_t HASH_PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t HASH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t HASH_PRIME3 = 0x165667B19E3779F9ULL;
+static const uint64_t HASH_PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t HASH_PRIME5 = 0x27D4EB2F165667C5ULL;
+
+/**
+ * @struct FocusMapHeader
+ * @brief Header of a map file, after its magic.
+ */
+struct FocusMapHeader {
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t windowSize;
+	uint32_t type;
+	uint32_t sampleBytes;
+};
+
+static inline uint64_t rotateLeft(uint64_t x, int bits) {
+	return (x << bits) | (x >> (64 - bits));
+}
+
+static inline uint64_t read64(const unsigned char* p) {
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint64_t hashRound(uint64_t acc, uint64_t input) {
+	return rotateLeft(acc + input * HASH_PRIME2, 31) * HASH_PRIME1;
+}
+
+/**
+ * @brief Hashes bytes, 32 at a time in four independent lanes (the xxHash64 algorithm)
+ * @param data The bytes
+ * @param length Number of bytes
+ * @param seed Seed of the hash
+ * @return The hash
+ */
+static uint64_t hashBytes(const unsigned char* data, size_t length, uint64_t seed) {
+	const unsigned char* end = data + length;
+	uint64_t hash;
+	if (length >= 32) {
+		uint64_t lanes[4] = {seed + HASH_PRIME1 + HASH_PRIME2, seed + HASH_PRIME2, seed, seed - HASH_PRIME1};
+		for (; data + 32 <= end; data += 32) {
+			for (int k = 0; k < 4; k++)
+				lanes[k] = hashRound(lanes[k], read64(data + 8 * k));
+		}
+		hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+		for (int k = 0; k < 4; k++)
+			hash = (hash ^ hashRound(0, lanes[k])) * HASH_PRIME1 + HASH_PRIME4;
+	}
+	else
+		hash = seed + HASH_PRIME5;
+	hash += length;
+
+	for (; data + 8 <= end; data += 8)
+		hash = rotateLeft(hash ^ hashRound(0, read64(data)), 27) * HASH_PRIME1 + HASH_PRIME4;
+	if (data + 4 <= end) {
+		uint32_t word;
+		memcpy(&word, data, sizeof(word));
+		hash = rotateLeft(hash ^ (word * HASH_PRIME1), 23) * HASH_PRIME2 + HASH_PRIME3;
+		data += 4;
+	}
+	for (; data < end; data++)
+		hash = rotateLeft(hash ^ (*data * HASH_PRIME5), 11) * HASH_PRIME1;
+
+	hash ^= hash >> 33;
+	hash *= HASH_PRIME2;
+	hash ^= hash >> 29;
+	hash *= HASH_PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t hashImagePixels(const RasterImage* image, uint64_t seed) {
+	const unsigned char* const* rows = (const unsigned char* const*) image->raster2D;
+	size_t rowBytes = (size_t) image->width * image->bytesPerPixel;
+	uint64_t hash = seed;
+	for (unsigned int row = 0; row < image->height; row++)
+		hash = hashBytes(rows[row], rowBytes, hash);
+	return hash;
+}
+
+/**
+ * @brief Reads the gray levels of a row of a layer, times three for a color layer, padded by replicating its ends
+ * @param layer The layer
+ * @param row The row
+ * @param pad Number of values added at each end
+ * @param gray Receives width + 2 * pad values
+ */
+template <typename Sample>
+static void readPaddedSampleRow(const RasterImage* layer, unsigned int row, int pad, Sample* gray) {
+	const unsigned int width = layer->width;
+	Sample* out = gray + pad;
+	if (layer->type == RGBA32_RASTER) {
+		const unsigned char* pixels = ((const unsigned char* const*) layer->raster2D)[row];
+		for (unsigned int col = 0; col < width; col++)
+			out[col] = pixels[4 * col] + pixels[4 * col + 1] + pixels[4 * col + 2];
+	}
+	else if (layer->type == GRAY_RASTER) {
+		const unsigned char* pixels = ((const unsigned char* const*) layer->raster2D)[row];
+		std::copy_n(pixels, width, out);
+	}
+	else {
+		const unsigned short* pixels = ((const unsigned short* const*) layer->raster2D)[row];
+		std::copy_n(pixels, width, out);
+	}
+	std::fill(gray, out, out[0]);
+	std::fill(out + width, out + width + pad, out[width - 1]);
+}
+
+/**
+ * @brief Computes the minimum and maximum over the window around each pixel of a layer
+ *
+ * Separable: the minimum and maximum along each row first, kept for the rows
+ * of one window (a ring), then along the columns.
+ * @param layer The layer
+ * @param windowSize Side of the window
+ * @param samples Receives the minimum and maximum of each pixel
+ */
+template <typename Sample>
+static void computeFocusMap(const RasterImage* layer, int windowSize, Sample* samples) {
+	const int width = layer->width;
+	const int height = layer->height;
+	const int half = windowSize / 2;
+	const int ringRows = 2 * half + 1;
+	std::vector<Sample> gray(width + 2 * half);
+	std::vector<Sample> ringMin((size_t) ringRows * width), ringMax(ringMin.size());
+	std::vector<Sample> windowMin(width), windowMax(width);
+
+	for (int row = 0; row < height + half; row++) {
+		//	Min and max of the row over the width of the window
+		if (row < height) {
+			readPaddedSampleRow(layer, row, half, gray.data());
+			Sample* minOut = ringMin.data() + (size_t) (row % ringRows) * width;
+			Sample* maxOut = ringMax.data() + (size_t) (row % ringRows) * width;
+			std::copy_n(gray.data(), width, minOut);
+			std::copy_n(gray.data(), width, maxOut);
+			for (int k = 1; k <= 2 * half; k++) {
+				const Sample* shifted = gray.data() + k;
+				for (int col = 0; col < width; col++) {
+					minOut[col] = std::min(minOut[col], shifted[col]);
+					maxOut[col] = std::max(maxOut[col], shifted[col]);
+				}
+			}
+		}
+
+		//	Then over the height of the window, once its last row is in the ring
+		const int center = row - half;
+		if (center < 0)
+			continue;
+		const int first = std::max(center - half, 0);
+		const int last = std::min(center + half, height - 1);
+		std::copy_n(ringMin.data() + (size_t) (first % ringRows) * width, width, windowMin.data());
+		std::copy_n(ringMax.data() + (size_t) (first % ringRows) * width, width, windowMax.data());
+		for (int r = first + 1; r <= last; r++) {
+			const Sample* minIn = ringMin.data() + (size_t) (r % ringRows) * width;
+			const Sample* maxIn = ringMax.data() + (size_t) (r % ringRows) * width;
+			for (int col = 0; col < width; col++) {
+				windowMin[col] = std::min(windowMin[col], minIn[col]);
+				windowMax[col] = std::max(windowMax[col], maxIn[col]);
+			}
+		}
+		Sample* out = samples + 2 * (size_t) center * width;
+		for (int col = 0; col < width; col++) {
+			out[2 * col] = windowMin[col];
+			out[2 * col + 1] = windowMax[col];
+		}
+	}
+}
+
+/**
+ * @brief Number of bytes per sample of the map of a layer
+ * @param type Type of the layer
+ * @return 1 for an 8-bit gray layer, 2 otherwise
+ */
+static inline uint32_t mapSampleBytes(ImageType type) {
+	return (type == GRAY_RASTER) ? 1 : 2;
+}
+
+/**
+ * @brief Size of the file of the map of a layer
+ * @param layer The layer
+ * @return Header and samples, in bytes
+ */
+static size_t mapFileSize(const RasterImage* layer) {
+	return FOCUS_MAP_HEADER_SIZE + 2 * (size_t) layer->width * layer->height * mapSampleBytes(layer->type);
+}
+
+FocusMap::FocusMap(const RasterImage* layer, int windowSize, void* theMapping, size_t theMappedSize)
+		:	width(layer->width),
+			height(layer->height),
+			ownedSamples(nullptr),
+			mapping(theMapping),
+			mappedSize(theMappedSize)
+{
+	void* samples;
+	if (mapping != nullptr)
+		samples = (unsigned char*) mapping + FOCUS_MAP_HEADER_SIZE;
+	else
+		samples = ownedSamples = malloc(mapFileSize(layer) - FOCUS_MAP_HEADER_SIZE);
+	initSamples_(layer->type, samples);
+	if (sampleBytes == 1)
+		computeFocusMap(layer, windowSize, (uint8_t*) samples);
+	else
+		computeFocusMap(layer, windowSize, (uint16_t*) samples);
+}
+
+FocusMap::FocusMap(unsigned int theWidth, unsigned int theHeight, ImageType theType, void* theMapping, size_t theMappedSize)
+		:	width(theWidth),
+			height(theHeight),
+			ownedSamples(nullptr),
+			mapping(theMapping),
+			mappedSize(theMappedSize)
+{
+	initSamples_(theType, (unsigned char*) mapping + FOCUS_MAP_HEADER_SIZE);
+}
+
+FocusMap::~FocusMap(void) {
+	if (mapping != nullptr)
+		munmap(mapping, mappedSize);
+	free(ownedSamples);
+}
+
+void FocusMap::initSamples_(ImageType type, void* samples) {
+	color = (type == RGBA32_RASTER);
+	sampleBytes = mapSampleBytes(type);
+	samples8 = (const uint8_t*) samples;
+	samples16 = (const uint16_t*) samples;
+}
+
+void FocusMap::grayRanges(unsigned int row, float* minGray, float* maxGray) const {
+	const size_t start = 2 * (size_t) row * width;
+	if (sampleBytes == 1) {
+		const uint8_t* samples = samples8 + start;
+		for (unsigned int col = 0; col < width; col++) {
+			minGray[col] = samples[2 * col];
+			maxGray[col] = samples[2 * col + 1];
+		}
+	}
+	else if (color) {
+		//	as blendPixelRows divides the sums of the channels
+		const uint16_t* samples = samples16 + start;
+		for (unsigned int col = 0; col < width; col++) {
+			minGray[col] = samples[2 * col] / 3.0f;
+			maxGray[col] = samples[2 * col + 1] / 3.0f;
+		}
+	}
+	else {
+		const uint16_t* samples = samples16 + start;
+		for (unsigned int col = 0; col < width; col++) {
+			minGray[col] = samples[2 * col];
+			maxGray[col] = samples[2 * col + 1];
+		}
+	}
+}
+
+/**
+ * @brief Maps a map file of the cache, if it is the map expected
+ * @param filePath Path to the file
+ * @param expected Header the file must have
+ * @param fileSize Size the file must have
+ * @return The mapping, or nullptr if the file isn't in the cache (or isn't valid)
+ */
+static void* mapCachedFile(const std::string& filePath, const FocusMapHeader& expected, size_t fileSize) {
+	int fd = open(filePath.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+	struct stat info;
+	void* mapping = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t) info.st_size == fileSize)
+		mapping = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return nullptr;
+	const unsigned char* bytes = (const unsigned char*) mapping;
+	if (memcmp(bytes, FOCUS_MAP_MAGIC, sizeof(FOCUS_MAP_MAGIC)) != 0 ||
+		memcmp(bytes + sizeof(FOCUS_MAP_MAGIC), &expected, sizeof(expected)) != 0) {
+		munmap(mapping, fileSize);
+		return nullptr;
+	}
+	madvise(mapping, fileSize, MADV_WILLNEED);
+	return mapping;
+}
+
+/**
+ * @brief Reads the map of a layer from the cache, or computes it and adds it to the cache
+ * @param cacheDir Directory of the cache
+ * @param layer The layer
+ * @param windowSize Side of the window
+ * @param tempSuffix Suffix of the temporary file of the map (unique to the process and the layer)
+ * @param cached Receives true if the map was in the cache
+ * @param written Receives false if the map couldn't be written to the cache
+ * @return The map
+ */
+static FocusMap* openFocusMap(const std::string& cacheDir, const RasterImage* layer, int windowSize,
+							  const std::string& tempSuffix, bool& cached, bool& written) {
+	FocusMapHeader header = {FOCUS_MAP_VERSION, layer->width, layer->height, (uint32_t) windowSize,
+							 (uint32_t) layer->type, mapSampleBytes(layer->type)};
+	uint64_t key = hashBytes((const unsigned char*) &header, sizeof(header), hashImagePixels(layer, FOCUS_MAP_VERSION));
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.focusmap", (unsigned long long) key);
+	std::string filePath = cacheDir + "/" + name;
+	size_t fileSize = mapFileSize(layer);
+
+	cached = true;
+	written = true;
+	if (void* mapping = mapCachedFile(filePath, header, fileSize))
+		return new FocusMap(layer->width, layer->height, layer->type, mapping, fileSize);
+
+	//	Computed straight into a temporary file, renamed into the cache once
+	//	complete.  Its blocks are allocated first (a sparse file would raise
+	//	SIGBUS in the middle of the computation on a full disk): if they can't
+	//	be, the map is computed in memory
+	cached = false;
+	std::string tempPath = filePath + tempSuffix;
+	int fd = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	void* mapping = MAP_FAILED;
+	if (fd >= 0 && posix_fallocate(fd, 0, fileSize) == 0)
+		mapping = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (fd >= 0)
+		close(fd);
+	if (mapping == MAP_FAILED) {
+		if (fd >= 0)
+			unlink(tempPath.c_str());
+		written = false;
+		return new FocusMap(layer, windowSize);
+	}
+	memcpy(mapping, FOCUS_MAP_MAGIC, sizeof(FOCUS_MAP_MAGIC));
+	memcpy((unsigned char*) mapping + sizeof(FOCUS_MAP_MAGIC), &header, sizeof(header));
+	FocusMap* map = new FocusMap(layer, windowSize, mapping, fileSize);
+	if (rename(tempPath.c_str(), filePath.c_str()) != 0) {
+		unlink(tempPath.c_str());
+		written = false;
+	}
+	return map;
+}
+
+std::vector<FocusMap*> openFocusMaps(const std::string& cacheDir, const std::vector<RasterImage*>& layers, int windowSize) {
+	std::error_code error;
+	std::filesystem::create_directories(cacheDir, error);
+
+	//	The layers are shared out among the threads as they finish
+	std::vector<FocusMap*> maps(layers.size(), nullptr);
+	std::atomic<size_t> nextLayer(0);
+	std::atomic<unsigned int> numCached(0), numUnwritten(0);
+	auto work = [&] {
+		for (size_t k = nextLayer++; k < layers.size(); k = nextLayer++) {
+			bool cached, written;
+			char tempSuffix[48];
+			snprintf(tempSuffix, sizeof(tempSuffix), ".%d-%zu.tmp", (int) getpid(), k);
+			maps[k] = openFocusMap(cacheDir, layers[k], windowSize, tempSuffix, cached, written);
+			numCached += cached;
+			numUnwritten += !written;
+		}
+	};
+	unsigned int numWorkers = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), layers.size());
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < numWorkers; i++)
+		workers.emplace_back(work);
+	work();
+	for (std::thread& worker : workers)
+		worker.join();
+
+	fprintf(stderr, "Focus maps: %u of %zu from the cache in %s%s\n", numCached.load(), layers.size(), cacheDir.c_str(),
+			(numUnwritten > 0) ? " (the others could not be written to it)" : "");
+	return maps;
+}
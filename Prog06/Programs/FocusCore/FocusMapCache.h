@@ -0,0 +1,162 @@
+/**
+ * @file FocusMapCache.h
+ * @brief Focus maps of the layers (the range of gray levels in the window around each pixel), cached on disk
+ *
+ * The contrast of a window is the range of its gray levels (see
+ * calculateWindowContrast), so the contrast of every window of a layer
+ * follows from its focus map: the minimum and maximum gray level over the
+ * window around each pixel.  With --map-cache=<dir>, the map of each layer
+ * is computed once (with separable min/max filters, one row at a time), and
+ * kept in <dir>: runs that differ only by their output, their number of
+ * threads, their version or --blend read the contrasts from the map instead
+ * of scanning every window of every layer again.
+ *
+ * The cache is addressed by content: a map is found by a hash of the pixels
+ * the run reads from the layer (so the same pixels in another file, or the
+ * same --roi region, share a map, while a rewritten file or another region
+ * gets its own), of their size and type, and of the window size.  Its file,
+ * <dir>/<key>.focusmap, is a 32-byte header (the magic "FOCUSMAP", then
+ * 32-bit words in host order: version, width, height, window size, image
+ * type and bytes per sample) followed by the minimum and maximum of each
+ * pixel, rows in raster order (bottom up).  The samples are gray levels
+ * times three for color layers (the sum of the three channels) so they stay
+ * integers: 1 byte for 8-bit gray layers, 2 bytes otherwise.  The maps are
+ * memory-mapped, so they are read from the page cache and shared by the
+ * processes focusing the same stack (e.g. the shards of FocusShard.h).
+ *
+ * Maps are written to a temporary file renamed into place, so a map found in
+ * the cache is complete; the directory can be emptied at any time.  The
+ * contrasts read from a map are exactly those calculateWindowContrast (and
+ * blendPixelRows) compute, so the output is the same with or without the cache.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef FOCUS_MAP_CACHE_H
+#define FOCUS_MAP_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RasterImage.h"
+
+/** @brief Size of the header of a map file, in bytes. */
+const size_t FOCUS_MAP_HEADER_SIZE = 32;
+
+/**
+ * @class FocusMap
+ * @brief Minimum and maximum gray level over the window around each pixel of a layer.
+ */
+class FocusMap {
+public:
+	/**
+	 * @brief Computes the map of a layer
+	 * @param layer The layer
+	 * @param windowSize Side of the window
+	 * @param theMapping Writable mapping of a map file (FOCUS_MAP_HEADER_SIZE bytes, then the samples)
+	 *		  to compute the map into, unmapped by the destructor, or nullptr to compute it in memory
+	 * @param theMappedSize Size of the mapped file
+	 */
+	FocusMap(const RasterImage* layer, int windowSize, void* theMapping = nullptr, size_t theMappedSize = 0);
+
+	/**
+	 * @brief Wraps a map read from the cache
+	 * @param theWidth Number of columns of the layer
+	 * @param theHeight Number of rows of the layer
+	 * @param theType Type of the layer
+	 * @param theMapping Mapping of the map file, unmapped by the destructor
+	 * @param theMappedSize Size of the mapped file
+	 */
+	FocusMap(unsigned int theWidth, unsigned int theHeight, ImageType theType, void* theMapping, size_t theMappedSize);
+
+	FocusMap(const FocusMap&) = delete;
+	FocusMap& operator=(const FocusMap&) = delete;
+
+	~FocusMap(void);
+
+	/**
+	 * @brief Contrast of the window around a pixel, as calculateWindowContrast computes it
+	 * @param row Row of the pixel
+	 * @param col Column of the pixel
+	 * @return Range of the gray levels in the window
+	 */
+	double windowContrast(unsigned int row, unsigned int col) const {
+		size_t i = 2 * ((size_t) row * width + col);
+		if (sampleBytes == 1)
+			return (double) samples8[i + 1] - samples8[i];
+		if (color)
+			return samples16[i + 1] / 3.0 - samples16[i] / 3.0;
+		return (double) samples16[i + 1] - samples16[i];
+	}
+
+	/**
+	 * @brief Minimum and maximum gray levels of the windows of a row, as blendPixelRows computes them
+	 * @param row The row
+	 * @param minGray Receives width minimums
+	 * @param maxGray Receives width maximums
+	 */
+	void grayRanges(unsigned int row, float* minGray, float* maxGray) const;
+
+	/** @brief Number of columns of the layer. */
+	unsigned int width;
+
+	/** @brief Number of rows of the layer. */
+	unsigned int height;
+
+	/** @brief True for a color layer: the samples are sums of the three channels. */
+	bool color;
+
+	/** @brief Bytes per sample (1 or 2). */
+	unsigned int sampleBytes;
+
+private:
+	/**
+	 * @brief Sets the type of the samples, and points to them
+	 * @param type Type of the layer
+	 * @param samples The samples
+	 */
+	void initSamples_(ImageType type, void* samples);
+
+	/** @brief Samples (minimum, maximum) of a map of an 8-bit gray layer. */
+	const uint8_t* samples8;
+
+	/** @brief Samples (minimum, maximum) of any other map. */
+	const uint16_t* samples16;
+
+	/** @brief Buffer to free, if the map was computed without a file. */
+	void* ownedSamples;
+
+	/** @brief Mapped file of the map, or nullptr. */
+	void* mapping;
+
+	/** @brief Size of the mapped file. */
+	size_t mappedSize;
+};
+
+/**
+ * @brief Reads the focus maps of the layers of a stack from the cache, computing (and caching) those it doesn't hold
+ *
+ * The layers are hashed, and their missing maps computed, by several threads.
+ * A map that can't be written to the cache (e.g. a read-only directory) is
+ * still computed, in memory, for this run.
+ * @param cacheDir Directory of the cache (created if it doesn't exist)
+ * @param layers The layers
+ * @param windowSize Side of the window
+ * @return The map of each layer
+ */
+std::vector<FocusMap*> openFocusMaps(const std::string& cacheDir, const std::vector<RasterImage*>& layers, int windowSize);
+
+/**
+ * @brief Hashes the pixels of an image (64 bits, not cryptographic)
+ *
+ * The rows are hashed in raster order, so the hash doesn't depend on how the
+ * image is stored (file format, row order, view of a larger image).
+ * @param image The image
+ * @param seed Seed of the hash
+ * @return The hash
+ */
+uint64_t hashImagePixels(const RasterImage* image, uint64_t seed);
+
+#endif // FOCUS_MAP_CACHE_H
@@ -0,0 +1,462 @@
+/**
+ * @file FocusServer.cpp
+ * @brief Focusing daemon that takes jobs over a Unix domain socket
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "FocusServer.h"
+#include "FocusStats.h"
+#include "ImageIO.h"
+#include "ThreadTuning.h"
+
+/** @brief Largest number of focusing threads accepted on the command line. */
+static const long MAX_THREADS = 4096;
+
+/** @brief Period of the progress frames, in milliseconds. */
+static const unsigned int PROGRESS_PERIOD_MS = 100;
+
+/** @brief Longest wait for a client to send its request, or to take a frame, in seconds. */
+static const int CLIENT_TIMEOUT_S = 5;
+
+/** @brief Set by SIGINT and SIGTERM. */
+static volatile sig_atomic_t stopRequested = 0;
+
+/**
+ * @brief Handler of SIGINT and SIGTERM: the server stops once its current job is done
+ * @param signalNumber The signal
+ */
+static void requestStop(int signalNumber) {
+	stopRequested = 1;
+}
+
+/**
+ * @class StackCache
+ * @brief Layers of the stacks used most recently, up to a number of bytes.
+ *
+ * Only the thread serving the jobs uses it, so it has no lock.
+ */
+class StackCache {
+public:
+	/**
+	 * @brief Creates an empty cache
+	 * @param theCapacity Most bytes held by the layers of the cached stacks
+	 */
+	StackCache(size_t theCapacity)
+			:	capacity(theCapacity),
+				size(0)
+	{
+	}
+
+	StackCache(const StackCache&) = delete;
+	StackCache& operator=(const StackCache&) = delete;
+
+	~StackCache(void) {
+		for (Entry& entry : entries)
+			deleteLayers(entry.layers);
+	}
+
+	/**
+	 * @brief Looks for a stack, and makes it the most recently used
+	 * @param key Key of the stack (see stackKey)
+	 * @param layers Receives the layers of the stack, if it is cached
+	 * @return false if it isn't
+	 */
+	bool find(const std::string& key, std::vector<RasterImage*>& layers) {
+		auto found = index.find(key);
+		if (found == index.end())
+			return false;
+		entries.splice(entries.begin(), entries, found->second);
+		layers = found->second->layers;
+		return true;
+	}
+
+	/**
+	 * @brief Adds a stack, dropping the least recently used ones beyond the capacity
+	 * @param key Key of the stack
+	 * @param layers The layers (the cache owns them from now on)
+	 * @return false if the stack is larger than the whole cache (the caller keeps the layers)
+	 */
+	bool insert(const std::string& key, const std::vector<RasterImage*>& layers) {
+		size_t bytes = 0;
+		for (const RasterImage* layer : layers)
+			bytes += (size_t) layer->bytesPerRow * layer->height;
+		if (bytes > capacity)
+			return false;
+		while (size + bytes > capacity) {
+			Entry& oldest = entries.back();
+			size -= oldest.bytes;
+			deleteLayers(oldest.layers);
+			index.erase(oldest.key);
+			entries.pop_back();
+		}
+		entries.push_front(Entry{key, layers, bytes});
+		index[key] = entries.begin();
+		size += bytes;
+		return true;
+	}
+
+private:
+	struct Entry {
+		std::string key;
+		std::vector<RasterImage*> layers;
+		size_t bytes;
+	};
+
+	static void deleteLayers(std::vector<RasterImage*>& layers) {
+		for (RasterImage* layer : layers)
+			delete layer;
+		layers.clear();
+	}
+
+	size_t capacity;
+	size_t size;
+
+	/** @brief Most recently used first. */
+	std::list<Entry> entries;
+	std::unordered_map<std::string, std::list<Entry>::iterator> index;
+};
+
+/**
+ * @brief Key of a stack in the cache: its region, then the name, size and modification time of its files
+ * @param options Options of the job (its input paths are the layers)
+ * @param key Receives the key
+ * @return false if a layer can't be read
+ */
+static bool stackKey(const FocusOptions& options, std::string& key) {
+	char text[128];
+	snprintf(text, sizeof(text), "roi=%ux%u+%u+%u\n", options.roi.width, options.roi.height, options.roi.x, options.roi.y);
+	key = text;
+	for (const std::string& path : options.inputPaths) {
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0 || access(path.c_str(), R_OK) != 0)
+			return false;
+		snprintf(text, sizeof(text), " %lld %lld.%09ld\n", (long long) info.st_size,
+				 (long long) info.st_mtim.tv_sec, (long) info.st_mtim.tv_nsec);
+		key += path + text;
+	}
+	return true;
+}
+
+bool sendFrame(int fd, const std::string& text) {
+	unsigned char header[4] = {(unsigned char) (text.size() >> 24), (unsigned char) (text.size() >> 16),
+							   (unsigned char) (text.size() >> 8), (unsigned char) text.size()};
+	std::string frame((const char*) header, 4);
+	frame += text;
+	//	MSG_NOSIGNAL: a client that went away is an error here, not a SIGPIPE
+	for (size_t sent = 0; sent < frame.size(); ) {
+		ssize_t count = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return false;
+		sent += count;
+	}
+	return true;
+}
+
+/**
+ * @brief Receives exactly a number of bytes
+ * @param fd The socket
+ * @param data Receives the bytes
+ * @param size Number of bytes
+ * @return false if the peer is gone first
+ */
+static bool receiveBytes(int fd, char* data, size_t size) {
+	for (size_t received = 0; received < size; ) {
+		ssize_t count = recv(fd, data + received, size - received, 0);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return false;
+		received += count;
+	}
+	return true;
+}
+
+bool receiveFrame(int fd, std::string& text) {
+	unsigned char header[4];
+	if (!receiveBytes(fd, (char*) header, 4))
+		return false;
+	size_t size = ((size_t) header[0] << 24) | ((size_t) header[1] << 16) | ((size_t) header[2] << 8) | header[3];
+	if (size > MAX_FRAME_SIZE)
+		return false;
+	text.resize(size);
+	return receiveBytes(fd, &text[0], size);
+}
+
+bool parseServerOptions(int argc, char** argv, ServerOptions& options) {
+	FocusOptions& defaults = options.jobs.defaults;
+	std::vector<char*> args;
+	bool badOption = false;
+	for (int i = 0; i < argc; i++) {
+		if (strncmp(argv[i], "--stats=", 8) == 0)
+			defaults.statsPeriodMs = atoi(argv[i] + 8);
+		else if (strcmp(argv[i], "--stats-json") == 0)
+			defaults.statsJSON = true;
+		else if (strncmp(argv[i], "--backend=", 10) == 0)
+			defaults.backendName = argv[i] + 10;
+		else if (strcmp(argv[i], "--recalibrate") == 0)
+			defaults.recalibrate = true;
+		else if (strncmp(argv[i], "--map-cache=", 12) == 0)
+			defaults.mapCacheDir = argv[i] + 12;
+		else if (strncmp(argv[i], "--cache=", 8) == 0)
+			options.cacheBytes = (size_t) strtoull(argv[i] + 8, NULL, 10) * 1024 * 1024;
+		else if (strncmp(argv[i], "--", 2) == 0)
+			badOption |= !applyJobOption(argv[i], defaults, options.jobs.windowSize);
+		else
+			args.push_back(argv[i]);
+	}
+	if (defaults.statsJSON && defaults.statsPeriodMs == 0)
+		defaults.statsPeriodMs = 1000;
+
+	//	The number of threads is "auto" or a positive integer
+	char* end = NULL;
+	long numThreads = (args.size() != 3) ? 0 : strtol(args[1], &end, 10);
+	bool autoThreads = (args.size() == 3 && strcmp(args[1], "auto") == 0);
+	if (badOption || args.size() != 3 || (!autoThreads && (*end != '\0' || numThreads < 1 || numThreads > MAX_THREADS))) {
+		fprintf(stderr, "Usage: %s [--stats=<ms>] [--stats-json] [--backend=<name>] [--recalibrate] [--cache=<MiB>] [--map-cache=<dir>] "
+				"[--blend] [--rle] [--roi=<w>x<h>+<x>+<y>] [--window=<n>] <num_threads>|auto <socket_path>\n"
+				"Back-ends: %s\n", argv[0], availableThreadBackends());
+		return false;
+	}
+
+	defaults.numThreads = autoThreads ? 0 : (unsigned int) numThreads;
+	options.socketPath = args[2];
+	return true;
+}
+
+/**
+ * @brief Creates the socket of the server, replacing the one a dead server left behind
+ * @param socketPath Path to the socket
+ * @return The listening socket, or -1 (reported) if it can't be created
+ */
+static int listenOn(const std::string& socketPath) {
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path)) {
+		fprintf(stderr, "The socket path %s is too long\n", socketPath.c_str());
+		return -1;
+	}
+	strcpy(address.sun_path, socketPath.c_str());
+
+	//	If a server answers on the path, it is taken; otherwise the file is stale
+	struct stat info;
+	if (lstat(socketPath.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+		int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		bool taken = connect(probe, (const sockaddr*) &address, sizeof(address)) == 0;
+		close(probe);
+		if (taken) {
+			fprintf(stderr, "A server is already listening on %s\n", socketPath.c_str());
+			return -1;
+		}
+		unlink(socketPath.c_str());
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || bind(fd, (const sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+		fprintf(stderr, "Cannot listen on %s: %s\n", socketPath.c_str(), strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * @struct ServerState
+ * @brief What the server keeps from job to job.
+ */
+struct ServerState {
+	const ServerOptions* options;
+	ThreadBackend* backend;
+	StackCache* cache;
+
+	/** @brief Number of focusing threads (0 until resolved, for "auto"). */
+	unsigned int numThreads;
+
+	/** @brief Set once the statistics are initialized (on the first job). */
+	bool statsStarted;
+};
+
+/**
+ * @brief Runs a job and answers the client
+ * @param state State of the server
+ * @param client The socket of the client
+ * @param request Text of the request, after "FOCUS "
+ */
+static void serveFocusJob(ServerState& state, int client, const std::string& request) {
+	BatchJob job;
+	std::string error;
+	if (!parseBatchJob(request, state.options->jobs, job, error) || job.inputFolder.empty()) {
+		sendFrame(client, "ERROR " + (error.empty() ? std::string("no job") : error));
+		return;
+	}
+	if (!listStackFiles(job.inputFolder, job.options.inputPaths)) {
+		sendFrame(client, "ERROR no image in " + job.inputFolder);
+		return;
+	}
+	std::string key;
+	if (!stackKey(job.options, key)) {
+		sendFrame(client, "ERROR cannot read the layers of " + job.inputFolder);
+		return;
+	}
+
+	//	The layers come from the cache, or are read (a layer that can't be is
+	//	the client's error: the server goes on)
+	std::vector<RasterImage*> layers;
+	bool cached = state.cache->find(key, layers);
+	if (!cached) {
+		const ImageRegion* region = (job.options.roi.width > 0) ? &job.options.roi : nullptr;
+		for (const std::string& path : job.options.inputPaths) {
+			RasterImage* layer = readImage(path.c_str(), region, &error);
+			if (layer == nullptr) {
+				for (RasterImage* read : layers)
+					delete read;
+				sendFrame(client, "ERROR " + error);
+				return;
+			}
+			layers.push_back(layer);
+		}
+	}
+	if (checkFocusStack(layers, job.options.outputPath, error) != 0) {
+		if (!cached) {
+			for (RasterImage* layer : layers)
+				delete layer;
+		}
+		sendFrame(client, "ERROR " + error);
+		return;
+	}
+	bool inCache = cached || state.cache->insert(key, layers);
+	FocusContext* ctx = createFocusContext(job.options, job.windowSize, layers);
+
+	//	"auto" is resolved on the first stack, for all the jobs
+	if (!state.statsStarted) {
+		if (state.numThreads == 0)
+			state.numThreads = autotuneThreads(ctx, job.options.recalibrate);
+		initializeStats(state.numThreads);
+		if (job.options.statsPeriodMs > 0)
+			startStatsReporter(job.options.statsPeriodMs, job.options.statsJSON);
+		state.statsStarted = true;
+	}
+	ctx->options.numThreads = state.numThreads;
+
+	//	A waiter thread wakes us when the threads are done; meanwhile the
+	//	client gets the progress (a client that left doesn't stop the job)
+	uint64_t start = statsNow();
+	startJobFocus(state.backend, ctx);
+	std::mutex mutex;
+	std::condition_variable finished;
+	bool done = false;
+	std::thread waiter([&] {
+		state.backend->wait();
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+		finished.notify_one();
+	});
+	bool clientThere = true;
+	int lastPercent = -1;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!finished.wait_for(lock, std::chrono::milliseconds(PROGRESS_PERIOD_MS), [&] { return done; })) {
+			int percent = (int) (100.0 * ctx->coverage->fractionCovered());
+			if (clientThere && percent != lastPercent) {
+				clientThere = sendFrame(client, "PROGRESS " + std::to_string(percent));
+				lastPercent = percent;
+			}
+		}
+	}
+	waiter.join();
+	double seconds = (statsNow() - start) * 1.0e-9;
+
+	const FocusOptions& options = ctx->options;
+	if (writeImageAtomically(options.outputPath.c_str(), ctx->imageOut, options.compressOutput) != kNoIOerror)
+		sendFrame(client, "ERROR cannot write " + options.outputPath);
+	else {
+		char reply[64];
+		snprintf(reply, sizeof(reply), "DONE %.3f %s", seconds, cached ? "cached" : "loaded");
+		sendFrame(client, reply);
+		fprintf(stderr, "%s: %zu layers of %ux%u (%s), focused in %.3f s\n", options.outputPath.c_str(),
+				layers.size(), ctx->imageOut->width, ctx->imageOut->height, cached ? "cached" : "loaded", seconds);
+	}
+
+	//	The cached layers stay for the next jobs
+	if (inCache)
+		ctx->imageStack.clear();
+	releaseFocusContext(ctx);
+}
+
+int runFocusServer(const ServerOptions& options) {
+	int listener = listenOn(options.socketPath);
+	if (listener < 0)
+		return 21;
+
+	//	Without SA_RESTART, so that accept returns on a signal
+	struct sigaction action = {};
+	action.sa_handler = requestStop;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	ServerState state = {&options, selectThreadBackend(options.jobs.defaults.backendName, "pool"),
+						 new StackCache(options.cacheBytes), options.jobs.defaults.numThreads, false};
+
+	//	Warm up the threads, so the first job doesn't pay for their creation
+	if (state.numThreads > 0) {
+		state.backend->start(state.numThreads, [](unsigned int) {});
+		state.backend->wait();
+	}
+	fprintf(stderr, "Listening on %s (%s back-end)\n", options.socketPath.c_str(), state.backend->name());
+
+	bool stopping = false;
+	while (!stopping && !stopRequested) {
+		int client = accept(listener, NULL, NULL);
+		if (client < 0)
+			continue;
+		//	The jobs are served one at a time: a client that sends nothing, or
+		//	stops reading its frames, mustn't hold up the ones behind it
+		timeval timeout = {CLIENT_TIMEOUT_S, 0};
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		std::string request;
+		if (receiveFrame(client, request)) {
+			if (request == "SHUTDOWN") {
+				sendFrame(client, "DONE");
+				stopping = true;
+			}
+			else if (request.compare(0, 6, "FOCUS ") == 0)
+				serveFocusJob(state, client, request.substr(6));
+			else
+				sendFrame(client, "ERROR unknown request");
+		}
+		close(client);
+	}
+
+	close(listener);
+	unlink(options.socketPath.c_str());
+	if (state.statsStarted) {
+		stopStatsReporter();
+		fprintf(stderr, "%s back-end: ", state.backend->name());
+		printStatsSummary();
+	}
+	delete state.cache;
+	delete state.backend;
+	return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file FocusServer.h
+ * @brief Focusing daemon that takes jobs over a Unix domain socket
+ *
+ * The server starts its threads once (the "pool" back-end by default, warmed
+ * up before the first job when the number of threads is given), then takes
+ * jobs from clients over a Unix domain socket, one at a time, in the order
+ * they connect.  It has no GUI, so no GL initialization either.
+ *
+ * Every message is a frame: the length of its text in bytes (4 bytes,
+ * big-endian), then the text.  A connection carries one request:
+ *
+ *	- "FOCUS <input_folder> <output_path> [options]": a job, in the syntax of
+ *	  a manifest line (see FocusBatch.h).  The server answers with
+ *	  "PROGRESS <percent>" frames while the stack is focused (about ten per
+ *	  second), then "DONE <seconds> cached|loaded" once the output is written,
+ *	  or "ERROR <message>" if the job can't be done.
+ *	- "SHUTDOWN": the server answers "DONE" and stops.
+ *
+ * The layers of recent stacks stay in memory: a job on a stack already in
+ * the cache skips the reading and decoding (for gray stacks the layers are
+ * the luma planes themselves).  A stack is recognized by its folder, its
+ * region of interest and the name, size and modification time of each of
+ * its files, so a stack rewritten on disk is read again.  The least recently
+ * used stacks are dropped beyond --cache=<MiB> (1024 by default, 0 to
+ * disable the cache).
+ *
+ * Jobs whose folder holds no image, whose layers can't be decoded, or whose
+ * layers don't match, are answered with an error; the server goes on.  A
+ * client has a few seconds to send its request (and to take each frame), so
+ * that one that connects and stays idle doesn't hold up the others.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef FOCUS_SERVER_H
+#define FOCUS_SERVER_H
+
+#include <cstddef>
+#include <string>
+#include "FocusBatch.h"
+
+/** @brief Largest frame accepted, in bytes. */
+const size_t MAX_FRAME_SIZE = 64 * 1024;
+
+/**
+ * @struct ServerOptions
+ * @brief Command line of the server.
+ */
+struct ServerOptions {
+	/** @brief Options of the whole process and defaults of the jobs, as for a batch (its manifest path is unused). */
+	BatchOptions jobs;
+
+	/** @brief Path to the socket. */
+	std::string socketPath;
+
+	/** @brief Most memory held by the cached stacks, in bytes. */
+	size_t cacheBytes = (size_t) 1024 * 1024 * 1024;
+};
+
+/**
+ * @brief Pulls the options out of the command line of the server
+ *
+ * Prints the usage line if the command line is incomplete.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param options Receives the options
+ * @return false if the command line is incomplete
+ */
+bool parseServerOptions(int argc, char** argv, ServerOptions& options);
+
+/**
+ * @brief Serves jobs on the socket until a client asks it to stop (or SIGINT/SIGTERM)
+ * @param options Options of the server
+ * @return Exit status: 0, or 21 if the socket can't be listened on
+ */
+int runFocusServer(const ServerOptions& options);
+
+/**
+ * @brief Sends a frame
+ * @param fd The socket
+ * @param text Text of the frame
+ * @return false if the peer is gone
+ */
+bool sendFrame(int fd, const std::string& text);
+
+/**
+ * @brief Receives a frame
+ * @param fd The socket
+ * @param text Receives the text of the frame
+ * @return false if the peer is gone (or timed out) or the frame is larger than MAX_FRAME_SIZE
+ */
+bool receiveFrame(int fd, std::string& text);
+
+#endif // FOCUS_SERVER_H
@@ -0,0 +1,346 @@
+/**
+ * @file FocusShard.cpp
+ * @brief Focusing of one stack by several processes, each a band of rows, and the merge of their results
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "FocusShard.h"
+#include "FocusStats.h"
+#include "ImageIO.h"
+
+/** @brief Largest number of focusing threads accepted on the command line. */
+static const long MAX_THREADS = 4096;
+
+/** @brief First bytes of a partial file. */
+static const char PARTIAL_MAGIC[8] = {'F', 'O', 'C', 'U', 'S', 'S', 'H', 'D'};
+
+/**
+ * @struct PartialHeader
+ * @brief Header of a partial file, after its magic.
+ */
+struct PartialHeader {
+	/** @brief Number of columns of the whole output. */
+	uint32_t width;
+
+	/** @brief Number of rows of the whole output. */
+	uint32_t height;
+
+	/** @brief First row of the band, counted from the top of the output. */
+	uint32_t firstRow;
+
+	/** @brief Number of rows of the band. */
+	uint32_t numRows;
+
+	/** @brief Type of the output image (an ImageType). */
+	uint32_t type;
+
+	/** @brief Maximum value of the output image. */
+	uint32_t maxVal;
+
+	/** @brief Index of the shard. */
+	uint32_t shardIndex;
+
+	/** @brief Number of shards. */
+	uint32_t numShards;
+};
+
+/**
+ * @brief Start of a row of an image (its rows may not be in order in memory, see RasterImage)
+ * @param image The image
+ * @param row Index of the row
+ * @return Pointer to the first byte of the row
+ */
+static inline unsigned char* rasterRow(const RasterImage* image, unsigned int row) {
+	return ((unsigned char* const*) image->raster2D)[row];
+}
+
+bool parseShardOptions(int argc, char** argv, ShardOptions& options) {
+	std::vector<char*> args;
+	bool badOption = false;
+	for (int i = 0; i < argc; i++) {
+		if (strncmp(argv[i], "--stats=", 8) == 0)
+			options.focus.statsPeriodMs = atoi(argv[i] + 8);
+		else if (strcmp(argv[i], "--stats-json") == 0)
+			options.focus.statsJSON = true;
+		else if (strncmp(argv[i], "--backend=", 10) == 0)
+			options.focus.backendName = argv[i] + 10;
+		else if (strcmp(argv[i], "--pin") == 0)
+			options.focus.pinThreads = true;
+		else if (strcmp(argv[i], "--recalibrate") == 0)
+			options.focus.recalibrate = true;
+		else if (strncmp(argv[i], "--map-cache=", 12) == 0)
+			options.focus.mapCacheDir = argv[i] + 12;
+		else if (strcmp(argv[i], "--rle") == 0)
+			badOption = true;	//	(an option of focusMerge, which writes the output)
+		else if (strncmp(argv[i], "--", 2) == 0)
+			badOption |= !applyJobOption(argv[i], options.focus, options.windowSize);
+		else
+			args.push_back(argv[i]);
+	}
+	if (options.focus.statsJSON && options.focus.statsPeriodMs == 0)
+		options.focus.statsPeriodMs = 1000;
+
+	//	The number of threads is "auto" or a positive integer, the shard <k>/<n> with k from 1 to n
+	char* end = NULL;
+	long numThreads = (args.size() < 5) ? 0 : strtol(args[1], &end, 10);
+	bool autoThreads = (args.size() >= 5 && strcmp(args[1], "auto") == 0);
+	unsigned int shard = 0, numShards = 0;
+	char trailing;
+	bool validShard = (args.size() >= 5 && sscanf(args[2], "%u/%u%c", &shard, &numShards, &trailing) == 2 &&
+					   shard >= 1 && shard <= numShards);
+	if (badOption || args.size() < 5 || !validShard ||
+		(!autoThreads && (*end != '\0' || numThreads < 1 || numThreads > MAX_THREADS))) {
+		fprintf(stderr, "Usage: %s [--stats=<ms>] [--stats-json] [--backend=<name>] [--pin] [--recalibrate] "
+				"[--map-cache=<dir>] [--blend] [--roi=<w>x<h>+<x>+<y>] [--window=<n>] <num_threads>|auto <shard>/<num_shards> "
+				"<output_path> <input_path>...\n"
+				"Back-ends: %s\n", argv[0], availableThreadBackends());
+		return false;
+	}
+
+	options.focus.numThreads = autoThreads ? 0 : (unsigned int) numThreads;
+	options.shardIndex = shard - 1;
+	options.numShards = numShards;
+	options.focus.outputPath = args[3];
+	options.focus.inputPaths.assign(args.begin() + 4, args.end());
+	return true;
+}
+
+bool parseMergeOptions(int argc, char** argv, MergeOptions& options) {
+	std::vector<char*> args;
+	bool badOption = false;
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--rle") == 0)
+			options.compressOutput = true;
+		else if (strcmp(argv[i], "--keep") == 0)
+			options.keepPartials = true;
+		else if (strncmp(argv[i], "--", 2) == 0)
+			badOption = true;
+		else
+			args.push_back(argv[i]);
+	}
+
+	char* end = NULL;
+	long numShards = (args.size() != 4) ? 0 : strtol(args[1], &end, 10);
+	if (badOption || args.size() != 4 || *end != '\0' || numShards < 1 || numShards > UINT32_MAX) {
+		fprintf(stderr, "Usage: %s [--rle] [--keep] <num_shards> <output_path> <depth_map_path>\n", argv[0]);
+		return false;
+	}
+
+	options.numShards = (unsigned int) numShards;
+	options.outputPath = args[2];
+	options.depthMapPath = args[3];
+	return true;
+}
+
+void shardRowRange(unsigned int height, unsigned int shardIndex, unsigned int numShards,
+				   unsigned int& firstRow, unsigned int& endRow) {
+	firstRow = (unsigned int) ((uint64_t) height * shardIndex / numShards);
+	endRow = (unsigned int) ((uint64_t) height * (shardIndex + 1) / numShards);
+}
+
+std::string shardPartialPath(const std::string& outputPath, unsigned int shardIndex, unsigned int numShards) {
+	return outputPath + ".shard-" + std::to_string(shardIndex + 1) + "-of-" + std::to_string(numShards);
+}
+
+/**
+ * @brief Writes the band of a shard (rows of the output and of the depth map), atomically
+ * @param filePath Path to the partial file
+ * @param ctx Context of the shard, once focused
+ * @param header Header of the partial
+ * @param bandEnd Raster row past the top row of the band (raster rows run from the bottom up)
+ * @return false if the file couldn't be written
+ */
+static bool writeShardPartial(const std::string& filePath, const FocusContext* ctx, const PartialHeader& header,
+							  unsigned int bandEnd) {
+	std::string tempPath = filePath + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == NULL)
+		return false;
+	bool written = fwrite(PARTIAL_MAGIC, 1, sizeof(PARTIAL_MAGIC), file) == sizeof(PARTIAL_MAGIC) &&
+				   fwrite(&header, sizeof(header), 1, file) == 1;
+	for (const RasterImage* image : {(const RasterImage*) ctx->imageOut, (const RasterImage*) ctx->depthMap}) {
+		size_t rowBytes = (size_t) image->width * image->bytesPerPixel;
+		for (unsigned int row = bandEnd; written && row > bandEnd - header.numRows; row--)
+			written = fwrite(rasterRow(image, row - 1), 1, rowBytes, file) == rowBytes;
+	}
+	written = (fclose(file) == 0) && written;
+	if (!written || rename(tempPath.c_str(), filePath.c_str()) != 0) {
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+int runShard(const ShardOptions& options) {
+	//	The bands split the region of interest, or the whole layers
+	const char* firstLayer = options.focus.inputPaths[0].c_str();
+	unsigned int width, height;
+	if (!readImageSize(firstLayer, width, height)) {
+		printf("Cannot read the size of image file %s\n", firstLayer);
+		return 11;
+	}
+	ImageRegion region = options.focus.roi;
+	if (region.width == 0) {
+		region.width = width;
+		region.height = height;
+	}
+	else if (!regionFits(region, width, height)) {
+		printf("The region %ux%u+%u+%u is not inside image file %s (%ux%u)\n", region.width, region.height,
+			   region.x, region.y, firstLayer, width, height);
+		return 19;
+	}
+	if (options.numShards > region.height) {
+		fprintf(stderr, "Cannot split %u rows into %u shards\n", region.height, options.numShards);
+		return 1;
+	}
+
+	//	Only the band is read, with the rows its windows reach above and below it
+	unsigned int firstRow, endRow;
+	shardRowRange(region.height, options.shardIndex, options.numShards, firstRow, endRow);
+	const unsigned int halo = options.windowSize / 2;
+	const unsigned int haloFirst = (firstRow > halo) ? firstRow - halo : 0;
+	const unsigned int haloEnd = std::min(endRow + halo, region.height);
+	FocusOptions focus = options.focus;
+	focus.roi = region;
+	focus.roi.y += haloFirst;
+	focus.roi.height = haloEnd - haloFirst;
+
+	FocusContext* ctx = initializeFocus(focus, options.windowSize);
+	ctx->depthMap = new RasterImage(ctx->imageOut->width, ctx->imageOut->height, GRAY_RASTER);
+	ctx->backend = selectThreadBackend(focus.backendName, "thread");
+
+	//	Raster rows run from the bottom up: the band is between the halos
+	const int bandStart = haloEnd - endRow;
+	const int bandEnd = haloEnd - firstRow;
+	uint64_t start = statsNow();
+	ctx->backend->start(ctx->options.numThreads, [ctx, bandStart, bandEnd](unsigned int i) {
+		int rowsPerThread = (bandEnd - bandStart) / ctx->options.numThreads;
+		int startRow = bandStart + i * rowsPerThread;
+		int stopRow = (i == ctx->options.numThreads - 1) ? bandEnd : startRow + rowsPerThread;
+		if (ctx->options.blend)
+			blendPixelRows(ctx, startRow, stopRow, i);
+		else
+			focusPixelRows(ctx, startRow, stopRow, i);
+	});
+	ctx->backend->wait();
+	double seconds = (statsNow() - start) * 1.0e-9;
+
+	PartialHeader header = {region.width, region.height, firstRow, endRow - firstRow, (uint32_t) ctx->imageOut->type,
+							ctx->imageOut->maxVal, options.shardIndex, options.numShards};
+	std::string partialPath = shardPartialPath(options.focus.outputPath, options.shardIndex, options.numShards);
+	int status = 0;
+	if (writeShardPartial(partialPath, ctx, header, bandEnd))
+		fprintf(stderr, "Shard %u/%u: rows %u to %u of %ux%u, focused in %.3f s\n", options.shardIndex + 1,
+				options.numShards, firstRow, endRow - 1, region.width, region.height, seconds);
+	else {
+		fprintf(stderr, "Cannot write the partial %s\n", partialPath.c_str());
+		status = 1;
+	}
+	stopStatsReporter();
+	fprintf(stderr, "%s back-end: ", ctx->backend->name());
+	printStatsSummary();
+
+	delete ctx->backend;
+	releaseFocusContext(ctx);
+	return status;
+}
+
+/**
+ * @brief Reads the partial of a shard into the output and the depth map (allocated from the first partial)
+ * @param filePath Path to the partial file
+ * @param shardIndex Index the shard must have
+ * @param options Options of the merge
+ * @param first Header of the first partial (receives it, for the first one)
+ * @param imageOut The output (allocated for the first partial)
+ * @param depthMap The depth map (allocated for the first partial)
+ * @return Exit status: 0, 11, 16 or 22 (see mergeShards)
+ */
+static int readShardPartial(const std::string& filePath, unsigned int shardIndex, const MergeOptions& options,
+							PartialHeader& first, RasterImage*& imageOut, RasterImage*& depthMap) {
+	FILE* file = fopen(filePath.c_str(), "rb");
+	if (file == NULL) {
+		printf("Cannot open the partial %s\n", filePath.c_str());
+		return 11;
+	}
+
+	char magic[sizeof(PARTIAL_MAGIC)];
+	PartialHeader header;
+	bool valid = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, PARTIAL_MAGIC, sizeof(magic)) == 0 &&
+				 fread(&header, sizeof(header), 1, file) == 1 && header.width > 0 && header.height > 0 &&
+				 (uint64_t) header.width * header.height <= UINT32_MAX / 4 && header.numShards > 0 &&
+				 (header.type == RGBA32_RASTER || header.type == GRAY_RASTER || header.type == DEEP_GRAY_RASTER);
+	if (!valid) {
+		printf("%s is not a partial file\n", filePath.c_str());
+		fclose(file);
+		return 16;
+	}
+
+	//	The bands must be those of the shards of one output
+	unsigned int firstRow, endRow;
+	shardRowRange(header.height, shardIndex, options.numShards, firstRow, endRow);
+	if (header.shardIndex != shardIndex || header.numShards != options.numShards || header.firstRow != firstRow ||
+		header.numRows != endRow - firstRow || (imageOut != nullptr && (header.width != first.width ||
+		header.height != first.height || header.type != first.type || header.maxVal != first.maxVal))) {
+		printf("%s is not shard %u of %u of the same output\n", filePath.c_str(), shardIndex + 1, options.numShards);
+		fclose(file);
+		return 22;
+	}
+	if (imageOut == nullptr) {
+		first = header;
+		imageOut = new RasterImage(header.width, header.height, (ImageType) header.type);
+		imageOut->maxVal = header.maxVal;
+		depthMap = new RasterImage(header.width, header.height, GRAY_RASTER);
+	}
+
+	//	The rows of the band run from the top down, raster rows from the bottom up
+	bool complete = true;
+	for (RasterImage* image : {imageOut, depthMap}) {
+		size_t rowBytes = (size_t) image->width * image->bytesPerPixel;
+		for (unsigned int row = firstRow; complete && row < endRow; row++)
+			complete = fread(rasterRow(image, header.height - 1 - row), 1, rowBytes, file) == rowBytes;
+	}
+	fclose(file);
+	if (!complete) {
+		printf("Truncated partial %s\n", filePath.c_str());
+		return 16;
+	}
+	return 0;
+}
+
+int mergeShards(const MergeOptions& options) {
+	PartialHeader first = {};
+	RasterImage* imageOut = nullptr;
+	RasterImage* depthMap = nullptr;
+	int status = 0;
+	for (unsigned int k = 0; k < options.numShards && status == 0; k++)
+		status = readShardPartial(shardPartialPath(options.outputPath, k, options.numShards), k, options,
+								  first, imageOut, depthMap);
+
+	std::string message;
+	if (status == 0 && (status = checkFocusStack({imageOut}, options.outputPath, message)) != 0)
+		fprintf(stderr, "%s\n", message.c_str());
+	if (status == 0) {
+		if (writeImageAtomically(options.outputPath.c_str(), imageOut, options.compressOutput) != kNoIOerror ||
+			writeImageAtomically(options.depthMapPath.c_str(), depthMap) != kNoIOerror)
+			status = 1;
+		else
+			fprintf(stderr, "Merged %u shards into %s (%ux%u) and %s\n", options.numShards,
+					options.outputPath.c_str(), imageOut->width, imageOut->height, options.depthMapPath.c_str());
+	}
+	if (status == 0 && !options.keepPartials) {
+		for (unsigned int k = 0; k < options.numShards; k++)
+			remove(shardPartialPath(options.outputPath, k, options.numShards).c_str());
+	}
+
+	delete imageOut;
+	delete depthMap;
+	return status;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file FocusShard.h
+ * @brief Focusing of one stack by several processes, each a band of rows, and the merge of their results
+ *
+ * A stack too large for the threads of one process is split into N shards:
+ * bands of rows of (nearly) equal height, from the top of the image (or of
+ * its --roi region) down.  Each shard is focused by its own process, which
+ * may run on another host as long as the layers and the output folder are on
+ * a shared filesystem:
+ *
+ *	focusShard 16 3/8 out/result.tga stack/layer_*.tga
+ *
+ * Each process reads only the rows of its band, plus a halo of half a window
+ * above and below it (the rows the windows of its edge pixels reach), so
+ * its pixels are exactly those a single run would compute.  It focuses them
+ * as Version1 does (or as --blend does), and writes them with their depth map
+ * to a partial file next to the output, <output>.shard-<k>-of-<n>.  Once all
+ * the shards are done, focusMerge assembles the partials into the output and
+ * its depth map, then removes them:
+ *
+ *	focusMerge 8 out/result.tga out/result_depth.pgm
+ *
+ * A partial file is a header (the magic "FOCUSSHD", then 32-bit words in host
+ * order: width and height of the whole output, first row of the band counted
+ * from the top, number of rows, image type, maximum value, index of the shard
+ * and number of shards), the rows of the band from the top down, then the
+ * same rows of the depth map.  It is written to a temporary file renamed
+ * into place, so a partial that exists is complete.
+ *
+ * Scripts/shard06.sh runs all the shards of a stack as local processes,
+ * then merges them.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef FOCUS_SHARD_H
+#define FOCUS_SHARD_H
+
+#include <string>
+#include "FocusBatch.h"
+
+/**
+ * @struct ShardOptions
+ * @brief Command line of a shard.
+ */
+struct ShardOptions {
+	/** @brief Options of the run; the output path is that of the merged output, not of the partial. */
+	FocusOptions focus;
+
+	/** @brief Side of the window examined around each pixel (also twice the halo, plus one). */
+	int windowSize = DEFAULT_BATCH_WINDOW_SIZE;
+
+	/** @brief Index of the shard, from 0. */
+	unsigned int shardIndex = 0;
+
+	/** @brief Number of shards the stack is split into. */
+	unsigned int numShards = 1;
+};
+
+/**
+ * @struct MergeOptions
+ * @brief Command line of the merge tool.
+ */
+struct MergeOptions {
+	/** @brief Number of shards the stack was split into. */
+	unsigned int numShards = 0;
+
+	/** @brief Path to the output image (the partials are found next to it). */
+	std::string outputPath;
+
+	/** @brief Path to the depth map. */
+	std::string depthMapPath;
+
+	/** @brief If true, the output image is written run-length encoded. */
+	bool compressOutput = false;
+
+	/** @brief If true, the partials are left in place once merged. */
+	bool keepPartials = false;
+};
+
+/**
+ * @brief Pulls the options out of the command line of a shard
+ *
+ * Prints the usage line if the command line is incomplete.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param options Receives the options
+ * @return false if the command line is incomplete
+ */
+bool parseShardOptions(int argc, char** argv, ShardOptions& options);
+
+/**
+ * @brief Pulls the options out of the command line of the merge tool
+ *
+ * Prints the usage line if the command line is incomplete.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @param options Receives the options
+ * @return false if the command line is incomplete
+ */
+bool parseMergeOptions(int argc, char** argv, MergeOptions& options);
+
+/**
+ * @brief Computes the rows of the band of a shard
+ * @param height Number of rows of the output
+ * @param shardIndex Index of the shard
+ * @param numShards Number of shards
+ * @param firstRow Receives the first row of the band, counted from the top
+ * @param endRow Receives the row past the end of the band
+ */
+void shardRowRange(unsigned int height, unsigned int shardIndex, unsigned int numShards,
+				   unsigned int& firstRow, unsigned int& endRow);
+
+/**
+ * @brief Path of the partial file of a shard
+ * @param outputPath Path of the merged output
+ * @param shardIndex Index of the shard
+ * @param numShards Number of shards
+ * @return e.g. "result.tga.shard-3-of-8" for the shard of index 2
+ */
+std::string shardPartialPath(const std::string& outputPath, unsigned int shardIndex, unsigned int numShards);
+
+/**
+ * @brief Focuses the band of a shard and writes its partial file
+ *
+ * Exits as the programs do if a layer can't be read, doesn't contain the
+ * region or doesn't match the others.
+ * @param options Options of the shard
+ * @return Exit status: 0, 11 if the size of the first layer can't be read, 19 if the region
+ *		   isn't inside it, 1 if there are more shards than rows or the partial can't be written
+ */
+int runShard(const ShardOptions& options);
+
+/**
+ * @brief Assembles the partial files of all the shards into the output and its depth map
+ * @param options Options of the merge
+ * @return Exit status: 0, 11 if a partial is missing, 16 if one is truncated or corrupt,
+ *		   17 for a 16-bit stack and an output that isn't a PGM file, 22 if the partials
+ *		   aren't the shards of one output, 1 if an image can't be written
+ */
+int mergeShards(const MergeOptions& options);
+
+#endif // FOCUS_SHARD_H
@@ -0,0 +1,185 @@
+/**
+ * @file FocusStats.cpp
+ * @brief Lock-free instrumentation counters for the focusing threads
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <cstdio>
+#include "FocusStats.h"
+
+std::atomic<unsigned int> numLiveFocusingThreads{0};
+
+/** @brief One counter block per focusing thread. */
+static ThreadStats* threadStats = nullptr;
+
+/** @brief Number of counter blocks allocated. */
+static unsigned int numStatsThreads = 0;
+
+/** @brief Time at which initializeStats was called, in nanoseconds. */
+static uint64_t statsStartTime = 0;
+
+/** @brief Number of pixels restored from a checkpoint. */
+static std::atomic<uint64_t> pixelsRestored{0};
+
+/** @brief The reporter thread, if one was started. */
+static std::thread reporterThread;
+
+/** @brief Protects reporterStopping. */
+static std::mutex reporterMutex;
+
+/** @brief Wakes the reporter thread when it must stop. */
+static std::condition_variable reporterWakeUp;
+
+/** @brief Set by stopStatsReporter to end the reporter thread. */
+static bool reporterStopping = false;
+
+uint64_t statsNow(void) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void initializeStats(unsigned int numThreads) {
+	//	aligned new: each block starts on its own cache line
+	threadStats = new ThreadStats[numThreads];
+	numStatsThreads = numThreads;
+	statsStartTime = statsNow();
+}
+
+ThreadStats* getThreadStats(unsigned int threadIndex) {
+	return threadStats + threadIndex;
+}
+
+StatsSnapshot gatherStats(void) {
+	StatsSnapshot snap = {};
+	uint64_t now = statsNow();
+	double elapsedNanos = static_cast<double>(now - statsStartTime);
+	snap.minUtilization = numStatsThreads > 0 ? 1.0 : 0.0;
+	for (unsigned int k = 0; k < numStatsThreads; k++) {
+		const ThreadStats& ts = threadStats[k];
+		snap.windowsProcessed += ts.windowsProcessed.load(std::memory_order_relaxed);
+		snap.pixelsWritten += ts.pixelsWritten.load(std::memory_order_relaxed);
+		snap.lockWaits += ts.lockWaits.load(std::memory_order_relaxed);
+		snap.lockWaitNanos += ts.lockWaitNanos.load(std::memory_order_relaxed);
+		snap.lockHoldNanos += ts.lockHoldNanos.load(std::memory_order_relaxed);
+
+		//	a thread works from its start to its end (or now), minus its lock waits
+		uint64_t start = ts.startNanos.load(std::memory_order_relaxed);
+		uint64_t end = ts.endNanos.load(std::memory_order_relaxed);
+		uint64_t runNanos = (start == 0) ? 0 : ((end == 0) ? now : end) - start;
+		uint64_t waitNanos = std::min(runNanos, ts.lockWaitNanos.load(std::memory_order_relaxed));
+		double utilization = elapsedNanos > 0 ? (runNanos - waitNanos) / elapsedNanos : 0.0;
+		snap.runNanos += runNanos;
+		snap.minUtilization = std::min(snap.minUtilization, utilization);
+		snap.maxUtilization = std::max(snap.maxUtilization, utilization);
+		snap.avgUtilization += utilization / numStatsThreads;
+	}
+	snap.pixelsRestored = pixelsRestored.load(std::memory_order_relaxed);
+	snap.elapsedSeconds = elapsedNanos * 1.0e-9;
+	snap.liveThreads = numLiveFocusingThreads.load(std::memory_order_relaxed);
+	snap.numThreads = numStatsThreads;
+	return snap;
+}
+
+StatsRates computeRates(const StatsSnapshot& before, const StatsSnapshot& after) {
+	StatsRates rates = {};
+	double seconds = after.elapsedSeconds - before.elapsedSeconds;
+	if (seconds > 0.0) {
+		rates.windowsPerSecond = (after.windowsProcessed - before.windowsProcessed) / seconds;
+		rates.megapixelsPerSecond = (after.pixelsWritten - before.pixelsWritten) * 1.0e-6 / seconds;
+	}
+	if (after.runNanos > before.runNanos)
+		rates.lockWaitPercent = 100.0 * (after.lockWaitNanos - before.lockWaitNanos) /
+								(after.runNanos - before.runNanos);
+	return rates;
+}
+
+void statsThreadStarted(ThreadStats* stats) {
+	stats->startNanos.store(statsNow(), std::memory_order_relaxed);
+	numLiveFocusingThreads.fetch_add(1, std::memory_order_relaxed);
+}
+
+void statsPixelsRestored(uint64_t count) {
+	pixelsRestored.fetch_add(count, std::memory_order_relaxed);
+}
+
+void statsThreadFinished(ThreadStats* stats) {
+	stats->endNanos.store(statsNow(), std::memory_order_relaxed);
+	numLiveFocusingThreads.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Body of the reporter thread.
+ * @param periodMs Period between two reports, in milliseconds.
+ * @param jsonFormat If true, prints one JSON object per line.
+ */
+static void statsReporterThread(unsigned int periodMs, bool jsonFormat) {
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(reporterMutex);
+			if (reporterWakeUp.wait_for(lock, std::chrono::milliseconds(periodMs), [] { return reporterStopping; }))
+				return;
+		}
+		StatsSnapshot snap = gatherStats();
+		if (jsonFormat) {
+			fprintf(stderr, "{\"elapsed\":%.3f,\"liveThreads\":%u,\"numThreads\":%u,"
+					"\"windows\":%llu,\"pixels\":%llu,\"lockWaits\":%llu,"
+					"\"lockWaitNs\":%llu,\"lockHoldNs\":%llu,"
+					"\"utilMin\":%.3f,\"utilAvg\":%.3f,\"utilMax\":%.3f}\n",
+					snap.elapsedSeconds, snap.liveThreads, snap.numThreads,
+					(unsigned long long) snap.windowsProcessed,
+					(unsigned long long) snap.pixelsWritten,
+					(unsigned long long) snap.lockWaits,
+					(unsigned long long) snap.lockWaitNanos,
+					(unsigned long long) snap.lockHoldNanos,
+					snap.minUtilization, snap.avgUtilization, snap.maxUtilization);
+		}
+		else {
+			fprintf(stderr, "[%8.2f s] threads %u/%u  windows %llu  pixels %llu  "
+					"lock waits %llu (%.3f s waiting, %.3f s held)\n",
+					snap.elapsedSeconds, snap.liveThreads, snap.numThreads,
+					(unsigned long long) snap.windowsProcessed,
+					(unsigned long long) snap.pixelsWritten,
+					(unsigned long long) snap.lockWaits,
+					snap.lockWaitNanos * 1.0e-9, snap.lockHoldNanos * 1.0e-9);
+		}
+		fflush(stderr);
+	}
+}
+
+void startStatsReporter(unsigned int periodMs, bool jsonFormat) {
+	if (reporterThread.joinable())
+		return;
+	reporterStopping = false;
+	reporterThread = std::thread(statsReporterThread, periodMs, jsonFormat);
+}
+
+void stopStatsReporter(void) {
+	if (!reporterThread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(reporterMutex);
+		reporterStopping = true;
+	}
+	reporterWakeUp.notify_one();
+	reporterThread.join();
+}
+
+void printStatsSummary(void) {
+	StatsSnapshot snap = gatherStats();
+	StatsRates rates = computeRates(StatsSnapshot{}, snap);
+	fprintf(stderr, "%u threads, %.3f s: %llu windows (%.0f/s), %.2f MPix/s, "
+			"utilization %.0f/%.0f/%.0f%% (min/avg/max), lock wait %.1f%%\n",
+			snap.numThreads, snap.elapsedSeconds,
+			(unsigned long long) snap.windowsProcessed, rates.windowsPerSecond,
+			rates.megapixelsPerSecond, 100.0 * snap.minUtilization,
+			100.0 * snap.avgUtilization, 100.0 * snap.maxUtilization,
+			rates.lockWaitPercent);
+	fflush(stderr);
+}
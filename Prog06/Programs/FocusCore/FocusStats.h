@@ -0,0 +1,197 @@
+/**
+ * @file FocusStats.h
+ * @brief Lock-free instrumentation counters for the focusing threads
+ *
+ * Each worker owns one cache-line-padded block of atomic counters that only
+ * it writes to (relaxed increments, no contention).  The GUI state pane and
+ * the optional stderr/JSON reporter aggregate the blocks without locking.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef FOCUS_STATS_H
+#define FOCUS_STATS_H
+
+#include <atomic>
+#include <cstdint>
+
+/** @brief Size of a cache line, used to keep per-thread data on separate lines. */
+const unsigned int CACHE_LINE_SIZE = 64;
+
+/**
+ * @struct ThreadStats
+ * @brief Counters updated by a single focusing thread.
+ *
+ * Only the owning thread writes to these (relaxed atomics), any thread may
+ * read them at any time.  The alignment keeps two threads' counters from
+ * sharing a cache line.
+ */
+struct alignas(CACHE_LINE_SIZE) ThreadStats {
+	/** @brief Number of windows (or pixel neighborhoods) evaluated over the stack. */
+	std::atomic<uint64_t> windowsProcessed{0};
+
+	/** @brief Number of output pixels written. */
+	std::atomic<uint64_t> pixelsWritten{0};
+
+	/** @brief Number of lock acquisitions that found the lock taken. */
+	std::atomic<uint64_t> lockWaits{0};
+
+	/** @brief Total time spent waiting for contended locks, in nanoseconds. */
+	std::atomic<uint64_t> lockWaitNanos{0};
+
+	/** @brief Total time spent holding locks, in nanoseconds. */
+	std::atomic<uint64_t> lockHoldNanos{0};
+
+	/** @brief Time at which the thread started working (0 if not yet), in nanoseconds. */
+	std::atomic<uint64_t> startNanos{0};
+
+	/** @brief Time at which the thread finished (0 while running), in nanoseconds. */
+	std::atomic<uint64_t> endNanos{0};
+};
+
+/**
+ * @struct StatsSnapshot
+ * @brief Sum of all the threads' counters at one point in time.
+ */
+struct StatsSnapshot {
+	uint64_t windowsProcessed;
+	uint64_t pixelsWritten;
+	/** @brief Pixels restored from a checkpoint (not in the rates: no thread computed them). */
+	uint64_t pixelsRestored;
+	uint64_t lockWaits;
+	uint64_t lockWaitNanos;
+	uint64_t lockHoldNanos;
+	/** @brief Total time the threads have been running, in nanoseconds. */
+	uint64_t runNanos;
+	/**
+	 * @brief Smallest, average and largest share (0 to 1) of the elapsed time
+	 *	the threads spent working, that is running and not waiting for a lock.
+	 */
+	double minUtilization, avgUtilization, maxUtilization;
+	/** @brief Seconds elapsed since initializeStats was called. */
+	double elapsedSeconds;
+	/** @brief Number of focusing threads currently running. */
+	unsigned int liveThreads;
+	/** @brief Number of focusing threads that were launched. */
+	unsigned int numThreads;
+};
+
+/**
+ * @struct StatsRates
+ * @brief Throughput between two snapshots.
+ */
+struct StatsRates {
+	double windowsPerSecond;
+	double megapixelsPerSecond;
+	/** @brief Share of the threads' running time spent waiting for locks, in percent. */
+	double lockWaitPercent;
+};
+
+/** @brief Count of the number of threads currently focusing on the image. */
+extern std::atomic<unsigned int> numLiveFocusingThreads;
+
+/**
+ * @brief Allocates one counter block per thread and starts the clock.
+ * @param numThreads Number of focusing threads that will be launched.
+ */
+void initializeStats(unsigned int numThreads);
+
+/**
+ * @brief Returns the counter block owned by a thread.
+ * @param threadIndex Index of the thread (0 to numThreads-1).
+ * @return Pointer to that thread's counters.
+ */
+ThreadStats* getThreadStats(unsigned int threadIndex);
+
+/**
+ * @brief Sums all the threads' counters without taking any lock.
+ * @return The aggregated counters.
+ */
+StatsSnapshot gatherStats(void);
+
+/**
+ * @brief Computes the throughput between two snapshots.
+ * @param before The earlier snapshot (all zero for averages since the start)
+ * @param after The later snapshot
+ * @return The rates over the interval (zero if the interval is empty)
+ */
+StatsRates computeRates(const StatsSnapshot& before, const StatsSnapshot& after);
+
+/**
+ * @brief Records that a thread started working and counts it as live.
+ * @param stats Counters of the calling thread.
+ */
+void statsThreadStarted(ThreadStats* stats);
+
+/**
+ * @brief Records that a thread finished and no longer counts it as live.
+ * @param stats Counters of the calling thread.
+ */
+void statsThreadFinished(ThreadStats* stats);
+
+/**
+ * @brief Counts pixels restored from a checkpoint (so the front end shows them).
+ * @param count Number of pixels restored.
+ */
+void statsPixelsRestored(uint64_t count);
+
+/**
+ * @brief Current value of a monotonic clock, in nanoseconds.
+ * @return Time in nanoseconds.
+ */
+uint64_t statsNow(void);
+
+/**
+ * @brief Starts a thread that periodically prints the counters to stderr, until stopStatsReporter.
+ * @param periodMs Period between two reports, in milliseconds.
+ * @param jsonFormat If true, prints one JSON object per line instead of plain text.
+ */
+void startStatsReporter(unsigned int periodMs, bool jsonFormat);
+
+/**
+ * @brief Stops the reporter thread, if one was started, and waits for it to end.
+ *
+ * Called before printStatsSummary, so no report follows the summary.
+ */
+void stopStatsReporter(void);
+
+/**
+ * @brief Prints a one-line summary of the whole run to stderr (for headless
+ *	runs and benchmarks).
+ */
+void printStatsSummary(void);
+
+/**
+ * @brief Locks a mutex, counting the wait if it was already taken.
+ * @param mutex The mutex to lock (any type with try_lock and lock).
+ * @param stats Counters of the calling thread.
+ * @return Time at which the lock was acquired (to pass to unlockCounted).
+ */
+template <class Mutex>
+uint64_t lockCounted(Mutex& mutex, ThreadStats* stats) {
+	if (!mutex.try_lock()) {
+		uint64_t waitStart = statsNow();
+		mutex.lock();
+		uint64_t acquiredAt = statsNow();
+		stats->lockWaits.fetch_add(1, std::memory_order_relaxed);
+		stats->lockWaitNanos.fetch_add(acquiredAt - waitStart, std::memory_order_relaxed);
+		return acquiredAt;
+	}
+	return statsNow();
+}
+
+/**
+ * @brief Unlocks a mutex and adds the time it was held to the thread's counters.
+ * @param mutex The mutex to unlock.
+ * @param stats Counters of the calling thread.
+ * @param acquiredAt Value returned by lockCounted.
+ */
+template <class Mutex>
+void unlockCounted(Mutex& mutex, ThreadStats* stats, uint64_t acquiredAt) {
+	uint64_t releasedAt = statsNow();
+	mutex.unlock();
+	stats->lockHoldNanos.fetch_add(releasedAt - acquiredAt, std::memory_order_relaxed);
+}
+
+#endif	//	FOCUS_STATS_H
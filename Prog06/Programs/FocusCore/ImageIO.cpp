@@ -0,0 +1,112 @@
+/**
+ * @file ImageIO.cpp
+ * @brief Reading and writing of images in any of the supported file formats
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include "ImageIO.h"
+#include "ImageIO_PNM.h"
+#include "ImageIO_TGA.h"
+
+ImageFileType imageFileType(const char* filePath) {
+	const char* extension = strrchr(filePath, '.');
+	if (extension == NULL || strchr(extension, '/') != NULL)
+		return kUnknownType;
+	if (strcasecmp(extension, ".ppm") == 0 || strcasecmp(extension, ".pnm") == 0)
+		return kPPM;
+	if (strcasecmp(extension, ".pgm") == 0)
+		return kPGM;
+	if (strcasecmp(extension, ".tga") == 0)
+		return kTGA_COLOR;
+	return kUnknownType;
+}
+
+RasterImage* readImage(const char* filePath, const ImageRegion* region, std::string* error) {
+	char magic[2] = {0, 0};
+	FILE* file = fopen(filePath, "rb");
+	if (file != NULL) {
+		if (fread(magic, 1, 2, file) != 2)
+			magic[0] = 0;
+		fclose(file);
+	}
+	//	(readTGA reports a file that can't be opened)
+	if (magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6'))
+		return readPNM(filePath, region, error);
+	return readTGA(filePath, region, error);
+}
+
+/**
+ * @brief Reads the next number of a PNM header, skipping whitespace and comments
+ * @param file The file, past the magic number
+ * @param value Receives the number
+ * @return false if there is no number there
+ */
+static bool nextPNMValue(FILE* file, unsigned int& value) {
+	int c = fgetc(file);
+	while (c == '#' || isspace(c)) {
+		if (c == '#') {
+			while (c != '\n' && c != EOF)
+				c = fgetc(file);
+		}
+		c = fgetc(file);
+	}
+	if (!isdigit(c))
+		return false;
+	value = 0;
+	while (isdigit(c) && value < 100000000) {
+		value = 10 * value + (c - '0');
+		c = fgetc(file);
+	}
+	return true;
+}
+
+bool readImageSize(const char* filePath, unsigned int& width, unsigned int& height) {
+	FILE* file = fopen(filePath, "rb");
+	if (file == NULL)
+		return false;
+	unsigned char head[18];
+	bool valid = fread(head, 1, 2, file) == 2;
+	if (valid && head[0] == 'P' && (head[1] == '5' || head[1] == '6'))
+		valid = nextPNMValue(file, width) && nextPNMValue(file, height);
+	else {
+		//	TGA: little-endian width and height at offsets 12 and 14
+		valid = valid && fread(head + 2, 1, 16, file) == 16;
+		width = head[12] | (head[13] << 8);
+		height = head[14] | (head[15] << 8);
+	}
+	fclose(file);
+	return valid && width > 0 && height > 0;
+}
+
+ImageIOErrorCode writeImage(const char* filePath, const RasterImage* image, bool compress) {
+	ImageFileType fileType = imageFileType(filePath);
+	if (fileType == kPPM || fileType == kPGM)
+		return writePNM(filePath, image);
+	return writeTGA(filePath, image, compress);
+}
+
+ImageIOErrorCode writeImageAtomically(const char* filePath, const RasterImage* image, bool compress) {
+	std::string tempPath = pathWithSuffix(filePath, ".tmp");
+	ImageIOErrorCode error = writeImage(tempPath.c_str(), image, compress);
+	if (error == kNoIOerror && rename(tempPath.c_str(), filePath) != 0) {
+		printf("Cannot rename %s to %s\n", tempPath.c_str(), filePath);
+		error = kErrorWriting;
+	}
+	if (error != kNoIOerror)
+		remove(tempPath.c_str());
+	return error;
+}
+
+std::string pathWithSuffix(const std::string& filePath, const std::string& suffix) {
+	size_t dot = filePath.rfind('.');
+	size_t slash = filePath.rfind('/');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return filePath + suffix;
+	return filePath.substr(0, dot) + suffix + filePath.substr(dot);
+}
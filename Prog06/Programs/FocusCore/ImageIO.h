@@ -0,0 +1,78 @@
+/**
+ * @file ImageIO.h
+ * @brief Reading and writing of images in any of the supported file formats
+ *
+ * TARGA (ImageIO_TGA.h) and binary PPM/PGM (ImageIO_PNM.h).  A file is read
+ * according to its content, and written according to the extension of its
+ * path.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <string>
+#include "RasterImage.h"
+
+/**
+ * @brief File format of an image path, from its extension
+ * @param filePath The path
+ * @return kPPM (.ppm, .pnm), kPGM (.pgm), kTGA_COLOR (.tga) or kUnknownType
+ */
+ImageFileType imageFileType(const char* filePath);
+
+/**
+ * @brief Reads an image: a PPM or PGM file if it starts with "P6" or "P5", a TGA file otherwise
+ *
+ * Exits if the image can't be read, like readTGA and readPNM, unless the
+ * caller asks for the error (a long-running process, e.g. the job server).
+ * @param filePath Path to the file to read
+ * @param region Region of the image to read (see readTGA and readPNM), or nullptr for all of it
+ * @param error If not nullptr, receives the message of an error instead of the program exiting
+ * @return The image read, or nullptr after an error reported in error
+ */
+RasterImage* readImage(const char* filePath, const ImageRegion* region = nullptr, std::string* error = nullptr);
+
+/**
+ * @brief Reads the size of an image from the header of its file, without reading its pixels
+ * @param filePath Path to the file
+ * @param width Receives the number of columns
+ * @param height Receives the number of rows
+ * @return false if the file can't be read or has no valid header
+ */
+bool readImageSize(const char* filePath, unsigned int& width, unsigned int& height);
+
+/**
+ * @brief Writes an image: as a PPM or PGM file for a .ppm, .pgm or .pnm path, a TGA file otherwise
+ * @param filePath Path to the file to write
+ * @param image The image
+ * @param compress If true, a TGA file is run-length encoded (ignored for PNM files)
+ * @return kNoIOerror if the image was written, an error code otherwise
+ */
+ImageIOErrorCode writeImage(const char* filePath, const RasterImage* image, bool compress = false);
+
+/**
+ * @brief Writes an image with writeImage to a temporary file next to its path, then renames it
+ *
+ * The rename is atomic, so the path always holds a complete image: the
+ * previous one until the new one is entirely written.  The temporary file
+ * is the path with a ".tmp" suffix (see pathWithSuffix); one left behind by
+ * a killed process is overwritten by the next write.
+ * @param filePath Path to the file to write
+ * @param image The image
+ * @param compress If true, a TGA file is run-length encoded
+ * @return kNoIOerror if the image was written, an error code otherwise
+ */
+ImageIOErrorCode writeImageAtomically(const char* filePath, const RasterImage* image, bool compress = false);
+
+/**
+ * @brief Inserts a suffix before the extension of a path (so the file keeps its format)
+ * @param filePath The path, e.g. "out/result.tga"
+ * @param suffix The suffix, e.g. ".checkpoint"
+ * @return The path with the suffix, e.g. "out/result.checkpoint.tga"
+ */
+std::string pathWithSuffix(const std::string& filePath, const std::string& suffix);
+
+#endif // IMAGE_IO_H
@@ -0,0 +1,236 @@
+/**
+ * @file ImageIO_PNM.cpp
+ * @brief Reading and writing of binary PPM (P6) and PGM (P5) images, 8 or 16 bits
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+#include "ImageIO_PNM.h"
+
+/**
+ * @brief Converts 16-bit samples between big-endian (the file) and the byte order of the host
+ * @param src Samples to convert
+ * @param dst Receives the converted samples (may not overlap src)
+ * @param count Number of samples
+ */
+static void swapBytes16(const unsigned char* src, unsigned char* dst, size_t count) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	memcpy(dst, src, 2 * count);
+#else
+	size_t k = 0;
+#if defined(__AVX2__)
+	const __m256i swap32 = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+											1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	for (; k + 16 <= count; k += 16) {
+		__m256i samples = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * k));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * k), _mm256_shuffle_epi8(samples, swap32));
+	}
+#endif
+#if defined(__SSSE3__)
+	const __m128i swap16 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	for (; k + 8 <= count; k += 8) {
+		__m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * k));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * k), _mm_shuffle_epi8(samples, swap16));
+	}
+#endif
+	for (; k < count; k++) {
+		dst[2 * k] = src[2 * k + 1];
+		dst[2 * k + 1] = src[2 * k];
+	}
+#endif
+}
+
+/**
+ * @brief Reads the next number of a PNM header, skipping whitespace and comments
+ * @param file The mapped file
+ * @param size Size of the file
+ * @param pos Position in the file (moved past the number)
+ * @param value Receives the number
+ * @return false if there is no number there
+ */
+static bool nextHeaderValue(const unsigned char* file, size_t size, size_t& pos, unsigned int& value) {
+	while (pos < size && (isspace(file[pos]) || file[pos] == '#')) {
+		if (file[pos] == '#') {
+			while (pos < size && file[pos] != '\n')
+				pos++;
+		}
+		else
+			pos++;
+	}
+	if (pos >= size || !isdigit(file[pos]))
+		return false;
+	uint64_t number = 0;
+	while (pos < size && isdigit(file[pos]) && number <= UINT32_MAX)
+		number = 10 * number + (file[pos++] - '0');
+	value = (unsigned int) number;
+	return number <= UINT32_MAX;
+}
+
+/**
+ * @brief Fails to read an image: reports the error to the caller if it asked for it, otherwise exits
+ * @param error Receives the message, or nullptr to print it and exit
+ * @param status Exit status
+ * @param format printf format of the message, then its arguments
+ * @return nullptr
+ */
+static RasterImage* readFailed(std::string* error, int status, const char* format, ...) {
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	if (error == nullptr) {
+		printf("%s\n", message);
+		exit(status);
+	}
+	*error = message;
+	return nullptr;
+}
+
+RasterImage* readPNM(const char* filePath, const ImageRegion* region, std::string* error) {
+	int fd = open(filePath, O_RDONLY);
+	struct stat info;
+	void* mapping = MAP_FAILED;
+	if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0)
+		mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (fd >= 0)
+		close(fd);
+	if (mapping == MAP_FAILED)
+		return readFailed(error, 11, "Cannot open image file %s", filePath);
+	size_t size = info.st_size;
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	const unsigned char* file = static_cast<const unsigned char*>(mapping);
+
+	//	"P6" or "P5", width, height, maximum value, then a single whitespace byte
+	bool color = (size >= 2 && file[0] == 'P' && file[1] == '6');
+	bool gray = (size >= 2 && file[0] == 'P' && file[1] == '5');
+	size_t pos = 2;
+	unsigned int width = 0, height = 0, maxVal = 0;
+	if ((!color && !gray) || !nextHeaderValue(file, size, pos, width) || !nextHeaderValue(file, size, pos, height) ||
+		!nextHeaderValue(file, size, pos, maxVal) || pos >= size || !isspace(file[pos]) ||
+		width == 0 || height == 0 || (uint64_t) width * height > UINT32_MAX / 4 ||
+		maxVal == 0 || maxVal > 65535 || (color && maxVal > 255)) {
+		munmap(mapping, size);
+		return readFailed(error, 12, "Unsupported PNM image %s: it must be a binary PPM with 8 bits per sample, "
+						  "or a binary PGM with 8 or 16 bits per sample.", filePath);
+	}
+	pos++;
+
+	unsigned int sampleBytes = (maxVal > 255) ? 2 : 1;
+	size_t fileRowBytes = (size_t) width * (color ? 3 : 1) * sampleBytes;
+	if (size - pos < fileRowBytes * height) {
+		munmap(mapping, size);
+		return readFailed(error, 16, "Truncated image file %s", filePath);
+	}
+
+	ImageRegion all;
+	all.width = width;
+	all.height = height;
+	if (region != nullptr && !regionFits(*region, width, height)) {
+		munmap(mapping, size);
+		return readFailed(error, 19, "The region %ux%u+%u+%u is not inside image file %s (%ux%u)", region->width,
+						  region->height, region->x, region->y, filePath, width, height);
+	}
+	const ImageRegion& r = (region != nullptr) ? *region : all;
+	const unsigned char* first = file + pos + r.y * fileRowBytes + (size_t) r.x * (color ? 3 : 1) * sampleBytes;
+
+	//	8-bit gray samples need no conversion: the image is a view of the
+	//	mapping, top row first, and unmaps it when deleted.  Only the rows of
+	//	the region are read ahead
+	if (gray && sampleBytes == 1) {
+		size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+		size_t start = (pos + r.y * fileRowBytes) / pageSize * pageSize;
+		madvise(static_cast<unsigned char*>(mapping) + start, pos + (r.y + r.height) * fileRowBytes - start,
+				MADV_WILLNEED);
+		RasterImage* view = new RasterImage(r.width, r.height, GRAY_RASTER, first, fileRowBytes, false, mapping, size);
+		view->maxVal = (unsigned short) maxVal;
+		return view;
+	}
+
+	ImageType type = color ? RGBA32_RASTER : ((sampleBytes == 2) ? DEEP_GRAY_RASTER : GRAY_RASTER);
+	RasterImage* image = new RasterImage(r.width, r.height, type);
+	image->maxVal = (unsigned short) maxVal;
+	unsigned char* raster = static_cast<unsigned char*>(image->raster);
+	for (unsigned int i = 0; i < r.height; i++) {
+		const unsigned char* src = first + i * fileRowBytes;
+		unsigned char* dst = raster + (size_t) (r.height - 1 - i) * image->bytesPerRow;
+		if (color) {
+			//	The 4th byte is left at 0, as the TGA reader does
+			for (unsigned int col = 0; col < r.width; col++)
+				memcpy(dst + 4 * col, src + 3 * col, 3);
+		}
+		else
+			swapBytes16(src, dst, r.width);
+	}
+
+	munmap(mapping, size);
+	return image;
+}
+
+ImageIOErrorCode writePNM(const char* filePath, const RasterImage* image) {
+	bool color = (image->type == RGBA32_RASTER);
+	bool deep = (image->type == DEEP_GRAY_RASTER);
+	if (!color && !deep && image->type != GRAY_RASTER) {
+		printf("Image type not supported for output in PNM format\n");
+		return kWrongFileType;
+	}
+
+	//	16-bit samples are written on 2 bytes, which a maximum value above 255 announces
+	unsigned int maxVal = deep ? std::max<unsigned int>(image->maxVal, 256) : 255;
+	unsigned int sampleBytes = deep ? 2 : 1;
+	char header[64];
+	size_t headerLength = snprintf(header, sizeof(header), "P%c\n%u %u\n%u\n", color ? '6' : '5',
+								   image->width, image->height, maxVal);
+	size_t fileRowBytes = (size_t) image->width * (color ? 3 : 1) * sampleBytes;
+	size_t size = headerLength + fileRowBytes * image->height;
+
+	//	The blocks are allocated before the file is mapped, so a full disk is
+	//	an error here rather than a SIGBUS while writing the pixels
+	int fd = open(filePath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		printf("Cannot create image file %s \n", filePath);
+		return kCannotOpenWrite;
+	}
+	void* mapping = MAP_FAILED;
+	if (posix_fallocate(fd, 0, size) == 0)
+		mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		printf("Cannot write image file %s\n", filePath);
+		return kErrorWriting;
+	}
+	unsigned char* file = static_cast<unsigned char*>(mapping);
+
+	memcpy(file, header, headerLength);
+	const unsigned char* raster = static_cast<const unsigned char*>(image->raster);
+	for (unsigned int i = 0; i < image->height; i++) {
+		const unsigned char* src = raster + (size_t) (image->height - 1 - i) * image->bytesPerRow;
+		unsigned char* dst = file + headerLength + i * fileRowBytes;
+		if (color) {
+			for (unsigned int col = 0; col < image->width; col++)
+				memcpy(dst + 3 * col, src + 4 * col, 3);
+		}
+		else if (deep)
+			swapBytes16(src, dst, image->width);
+		else
+			memcpy(dst, src, image->width);
+	}
+
+	munmap(mapping, size);
+	return kNoIOerror;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file ImageIO_PNM.h
+ * @brief Reading and writing of binary PPM (P6) and PGM (P5) images, 8 or 16 bits
+ *
+ * The files are memory-mapped: pixels are converted straight between the
+ * mapping and the raster, without intermediate buffers or stdio.  16-bit
+ * samples are big-endian in the file; they are byte-swapped with SSSE3/AVX2
+ * shuffles when the compiler targets them.  PNM rows run from the top of the
+ * image down, while raster rows (like the rows of a TGA file) run from the
+ * bottom up, so rows are flipped both ways.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef IMAGE_IO_PNM_H
+#define IMAGE_IO_PNM_H
+
+#include <string>
+#include "RasterImage.h"
+
+/**
+ * @brief Reads a binary PPM or PGM image
+ *
+ * P6 files (8 bits per sample) give a RGBA32_RASTER, P5 files a GRAY_RASTER
+ * (maximum value up to 255) or a DEEP_GRAY_RASTER (up to 65535, e.g. 12-bit
+ * microscope images); maxVal is the maximum value of the file.  An 8-bit
+ * GRAY_RASTER is a view of the mapped file (see RasterImage), since its
+ * samples need no conversion; its rows are top row first.  Exits if the
+ * file can't be read (11), isn't a supported PNM image (12), is truncated (16)
+ * or doesn't contain the region (19), unless the caller asks for the error.
+ * With a region, only its pixels are converted (and only its rows are read
+ * from the disk).
+ * @param filePath Path to the file to read
+ * @param region Region of the image to read, or nullptr for all of it
+ * @param error If not nullptr, receives the message of an error instead of the program exiting
+ * @return The image read, or nullptr after an error reported in error
+ */
+RasterImage* readPNM(const char* filePath, const ImageRegion* region = nullptr, std::string* error = nullptr);
+
+/**
+ * @brief Writes an image as a binary PPM (color) or PGM (gray) file
+ *
+ * A DEEP_GRAY_RASTER is written as a PGM file on 2 bytes per sample, with its
+ * maxVal (at least 256, the smallest that announces 2-byte samples).
+ * @param filePath Path to the file to write
+ * @param image The image (RGBA32_RASTER, GRAY_RASTER or DEEP_GRAY_RASTER)
+ * @return kNoIOerror if the image was written, an error code otherwise
+ */
+ImageIOErrorCode writePNM(const char* filePath, const RasterImage* image);
+
+#endif // IMAGE_IO_PNM_H
@@ -0,0 +1,519 @@
+/*----------------------------------------------------------------------------------+
+|	This is a modified version of the so-called "Lighthouse Library" for reading	|
+|	images encoded in the *uncompressed, uncommented .tga (TARGA file) format. 		|
+|	I had been using and modifying this code for years, simply mentioning			|
+|	"Source Unknown" in my comments when I finally discovered, thanks to Web		|
+|	searches, the origin of this code.  By then it had been adapted to work along	|
+|	with reader/writer code for another image file format: the awful PPM/PBM/PGM	|
+|	format of obvious Unix origin.													|
+|	This is just to say that I am not claiming authorship of this code.  I am only	|
+|	distributing it in this form instead of the original because (1) I have long	|
+|	lost the original code, and (2) This version works with images organized		|
+|	nicely into a struct.															|
+|																					|
+|	Jean-Yves Hervé		Dept. of Computer Science and Statistics, URI				|
+|						2018-09-26													|
++----------------------------------------------------------------------------------*/
+
+#include <cstdarg>
+#include <cstdlib>        
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImageIO_TGA.h"
+
+void swapRGB_(unsigned char* theData, unsigned int height, unsigned int width);
+void swapRGBA_(unsigned char* theData, unsigned int height, unsigned int width);
+static bool decodeRLE_(const unsigned char* packets, size_t numBytes, unsigned char* data,
+					   unsigned int numPixels, bool color);
+static void flipRows_(unsigned char* data, unsigned int height, unsigned int bytesPerRow);
+static void writeRLE_(const RasterImage* image, FILE* tga_out);
+static RasterImage* readFailed_(std::string* error, int status, const char* format, ...);
+
+
+//----------------------------------------------------------------------
+//	Utility function for memory swapping
+//	Used because TGA stores the RGB data in reverse order (BGR)
+//----------------------------------------------------------------------
+void swapRGB_(unsigned char* theData, unsigned int height, unsigned int width)
+{
+    unsigned int numBytes = height*width;
+
+	for(unsigned int k = 0; k < numBytes; k++)
+	{
+		unsigned char tmp = theData[k*3+2];
+		theData[k*3+2] = theData[k*3];
+		theData[k*3] = tmp;
+	}
+}
+
+void swapRGBA_(unsigned char* theData, unsigned int height, unsigned int width)
+{
+    unsigned int numBytes = height*width;
+    
+    for(unsigned int k=0; k<numBytes; k++){
+        unsigned char temp = theData[k*4+2];
+        theData[k*4+2] = theData[k*4];
+        theData[k*4] = temp;
+    }
+}
+
+//----------------------------------------------------------------------
+//	Utility function that mirrors an image vertically, in place
+//----------------------------------------------------------------------
+static void flipRows_(unsigned char* data, unsigned int height, unsigned int bytesPerRow)
+{
+	for (unsigned int i = 0; i < height/2; i++)
+		std::swap_ranges(data + i*bytesPerRow, data + (i+1)*bytesPerRow,
+						 data + (height-1-i)*bytesPerRow);
+}
+
+//----------------------------------------------------------------------
+//	Run-length decoding (image types 10 and 11)
+//
+//	Each packet starts with a byte whose high bit tells a run packet (one
+//	pixel value repeated) from a raw packet (pixel values copied), and whose
+//	low 7 bits hold the number of pixels minus one.  Runs are expanded with
+//	memset / fill_n, which the compiler vectorizes.  Color pixels are stored
+//	in the file on 3 bytes (BGR) and in the raster on 4 (the 4th byte is left
+//	at 0, as for uncompressed files).
+//	Returns false if the packets are truncated or overflow the image.
+//----------------------------------------------------------------------
+static bool decodeRLE_(const unsigned char* packets, size_t numBytes, unsigned char* data,
+					   unsigned int numPixels, bool color)
+{
+	const size_t filePixelSize = color ? 3 : 1;
+	size_t pos = 0;
+	unsigned int pixel = 0;
+	while (pixel < numPixels)
+	{
+		if (pos >= numBytes)
+			return false;
+		unsigned char packetHead = packets[pos++];
+		unsigned int count = (packetHead & 0x7F) + 1;
+		if (count > numPixels - pixel)
+			return false;
+
+		//	Run packet
+		if (packetHead & 0x80)
+		{
+			if (numBytes - pos < filePixelSize)
+				return false;
+			if (color)
+			{
+				uint32_t value = 0;
+				memcpy(&value, packets + pos, 3);
+				std::fill_n(reinterpret_cast<uint32_t*>(data) + pixel, count, value);
+			}
+			else
+				memset(data + pixel, packets[pos], count);
+			pos += filePixelSize;
+		}
+		//	Raw packet
+		else
+		{
+			if (numBytes - pos < count*filePixelSize)
+				return false;
+			if (color)
+			{
+				for (unsigned int k = 0; k < count; k++)
+					memcpy(data + 4*(pixel+k), packets + pos + 3*k, 3);
+			}
+			else
+				memcpy(data + pixel, packets + pos, count);
+			pos += count*filePixelSize;
+		}
+		pixel += count;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------
+//	Run-length encoding of one row (packets never cross a scanline, as the
+//	format recommends).  A run packet is used for runs of at least 2 color
+//	pixels or 3 gray pixels, the shortest runs that save space.
+//----------------------------------------------------------------------
+static void encodeRLERow_(const unsigned char* row, unsigned int width, bool color,
+						  std::vector<unsigned char>& out)
+{
+	const unsigned int pixelSize = color ? 4 : 1;
+	const unsigned int minRun = color ? 2 : 3;
+	auto same = [&](unsigned int a, unsigned int b) {
+		return memcmp(row + a*pixelSize, row + b*pixelSize, color ? 3 : 1) == 0;
+	};
+	auto runLength = [&](unsigned int start) {
+		unsigned int length = 1;
+		while (start + length < width && length < 128 && same(start, start + length))
+			length++;
+		return length;
+	};
+	auto emitPixel = [&](unsigned int col) {
+		const unsigned char* p = row + col*pixelSize;
+		if (color)
+		{
+			out.push_back(p[2]);
+			out.push_back(p[1]);
+			out.push_back(p[0]);
+		}
+		else
+			out.push_back(p[0]);
+	};
+
+	unsigned int col = 0;
+	while (col < width)
+	{
+		unsigned int length = runLength(col);
+		if (length >= minRun)
+		{
+			out.push_back((unsigned char) (0x80 | (length - 1)));
+			emitPixel(col);
+			col += length;
+		}
+		else
+		{
+			//	Raw pixels, up to the start of the next worthwhile run
+			unsigned int end = col + length;
+			while (end < width && end - col < 128 && runLength(end) < minRun)
+				end++;
+			end = std::min(end, col + 128);
+			out.push_back((unsigned char) (end - col - 1));
+			for (unsigned int k = col; k < end; k++)
+				emitPixel(k);
+			col = end;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	Writes the pixel data of an image, run-length encoded.  The rows are
+//	split into one stripe per hardware thread; each stripe is encoded into
+//	its own buffer in parallel, then the buffers are written in order.
+//----------------------------------------------------------------------
+static void writeRLE_(const RasterImage* image, FILE* tga_out)
+{
+	bool color = (image->type == RGBA32_RASTER);
+	const unsigned char* data = (const unsigned char*) image->raster;
+	unsigned int numStripes = std::max(1u, std::min(std::thread::hardware_concurrency(), image->height));
+	std::vector<std::vector<unsigned char>> stripes(numStripes);
+
+	auto encodeStripe = [&](unsigned int s) {
+		unsigned int firstRow = (unsigned int) ((unsigned long) image->height*s/numStripes);
+		unsigned int lastRow = (unsigned int) ((unsigned long) image->height*(s+1)/numStripes);
+		stripes[s].reserve((size_t) (lastRow - firstRow) * image->width * (color ? 3 : 1));
+		for (unsigned int i = firstRow; i < lastRow; i++)
+			encodeRLERow_(data + (size_t) i*image->bytesPerRow, image->width, color, stripes[s]);
+	};
+	std::vector<std::thread> encoders;
+	for (unsigned int s = 1; s < numStripes; s++)
+		encoders.emplace_back(encodeStripe, s);
+	encodeStripe(0);
+	for (std::thread& encoder : encoders)
+		encoder.join();
+
+	for (const std::vector<unsigned char>& stripe : stripes)
+		fwrite(stripe.data(), sizeof(char), stripe.size(), tga_out);
+}
+
+//----------------------------------------------------------------------
+//	Failure of readTGA: the message goes to the caller if it asked for it,
+//	otherwise it is printed and the program exits with the status
+//----------------------------------------------------------------------
+static RasterImage* readFailed_(std::string* error, int status, const char* format, ...)
+{
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	if (error == nullptr)
+	{
+		printf("%s\n", message);
+		exit(status);
+	}
+	*error = message;
+	return nullptr;
+}
+
+// ---------------------------------------------------------------------
+//	Function : readTGA 
+//	Description :
+//	
+//	This function reads an image of type TGA (8 or 24 bits, uncompressed
+//	or run-length encoded)
+//	
+//----------------------------------------------------------------------
+
+RasterImage* readTGA(const char* filePath, const ImageRegion* region, std::string* error)
+{
+	//--------------------------------
+	//	open TARGA input file
+	//--------------------------------
+	FILE* tga_in = fopen(filePath, "rb" );
+	if (tga_in == nullptr)
+		return readFailed_(error, 11, "Cannot open image file %s", filePath);
+
+	//--------------------------------
+	//	Read the header (TARGA file)
+	//--------------------------------
+	char	head[18] ;
+	if (fread( head, sizeof(char), 18, tga_in ) != 18)
+	{
+		fclose(tga_in);
+		return readFailed_(error, 16, "Truncated image file %s", filePath);
+	}
+	/* Get the size of the image */
+	unsigned int imgWidth = ((unsigned int)head[12]&0xFF) | (unsigned int)head[13]*256;
+	unsigned int imgHeight = ((unsigned int)head[14]&0xFF) | (unsigned int)head[15]*256;
+	unsigned int numBytes = imgWidth * imgHeight;
+	//	Types 10 and 11 are the run-length encoded versions of types 2 and 3
+	bool isRLE = (head[2] == 10) || (head[2] == 11);
+
+	ImageType imgType;
+	//unsigned short maxVal;
+	//unsigned int bytesPerPixel;
+	//unsigned int bytesPerRow;
+	if(((head[2] == 2) || (head[2] == 10)) && (head[16] == 24))
+	{
+		imgType = RGBA32_RASTER;
+		//maxVal = 255;
+		//bytesPerPixel = 4;
+		//bytesPerRow = 4*imgWidth;
+	}
+	else if(((head[2] == 3) || (head[2] == 11)) && (head[16] == 8))
+	{
+		imgType = GRAY_RASTER;
+		//maxVal = 255;
+		//bytesPerPixel = 1;
+		//bytesPerRow = imgWidth;
+	}
+	else
+	{
+		fclose(tga_in);
+		return readFailed_(error, 12, "Unsupported TGA image %s: its type is %d and it has %d bits per pixel. "
+						   "The image must be uncompressed or run-length encoded while having 8 or 24 bits per pixel.",
+						   filePath, head[2], head[16]);
+	}
+
+	if (region != nullptr && !regionFits(*region, imgWidth, imgHeight))
+	{
+		fclose(tga_in);
+		return readFailed_(error, 19, "The region %ux%u+%u+%u is not inside image file %s (%ux%u)", region->width,
+						   region->height, region->x, region->y, filePath, imgWidth, imgHeight);
+	}
+
+	//	Skip the image ID field, if any
+	fseek(tga_in, head[0] & 0xFF, SEEK_CUR);
+
+	//	An uncompressed gray-level image is used in place: its pixels are those
+	//	of the file, in either row order.  If the file can't be mapped (or is
+	//	short), it is read into memory as before
+	if (!isRLE && imgType == GRAY_RASTER)
+	{
+		RasterImage* view = mapRasterView(filePath, 18 + (head[0] & 0xFF), imgWidth, imgHeight,
+										  GRAY_RASTER, !(head[17]&0x20), region);
+		if (view != nullptr)
+		{
+			fclose(tga_in);
+			return view;
+		}
+	}
+
+	//	Case of an uncompressed image (or of a region of one): only the rows
+	//	of the region are read, each into its own row of the raster, and only
+	//	its columns converted
+	if (!isRLE)
+	{
+		ImageRegion whole;
+		whole.width = imgWidth;
+		whole.height = imgHeight;
+		if (region == nullptr)
+			region = &whole;
+		unsigned int fileBytesPerPixel = (imgType == RGBA32_RASTER) ? 3 : 1;
+		long dataStart = ftell(tga_in);
+		RasterImage* image = new RasterImage(region->width, region->height, imgType);
+		std::vector<unsigned char> fileRow((size_t) region->width * fileBytesPerPixel);
+		for (unsigned int i = 0; i < region->height; i++)
+		{
+			//	(row 0 of the region is its bottom row)
+			unsigned int imgRow = imgHeight - region->y - region->height + i;
+			unsigned int fileRowIndex = (head[17]&0x20) ? imgHeight - 1 - imgRow : imgRow;
+			if (fseek(tga_in, dataStart + ((long) fileRowIndex*imgWidth + region->x)*fileBytesPerPixel, SEEK_SET) != 0 ||
+				fread(fileRow.data(), sizeof(char), fileRow.size(), tga_in) != fileRow.size())
+			{
+				delete image;
+				fclose(tga_in);
+				return readFailed_(error, 16, "Truncated image file %s", filePath);
+			}
+			unsigned char* dest = (unsigned char*) image->raster + (size_t) i*image->bytesPerRow;
+			if (imgType == RGBA32_RASTER)
+			{
+				for (unsigned int j=0; j<region->width; j++)
+					memcpy(dest + 4*j, fileRow.data() + 3*j, 3);
+			}
+			else
+				memcpy(dest, fileRow.data(), fileRow.size());
+		}
+		if (imgType == RGBA32_RASTER)
+			swapRGBA_((unsigned char*) image->raster, image->height, image->width);
+		fclose(tga_in);
+		return image;
+	}
+
+	//	Case of a run-length encoded image: the packets are read in one go,
+	//	then expanded straight into the raster
+	//------------------------	
+	RasterImage* image = new RasterImage(imgWidth, imgHeight, imgType);
+	unsigned char* data = (unsigned char*) image->raster;
+	long start = ftell(tga_in);
+	fseek(tga_in, 0, SEEK_END);
+	long end = ftell(tga_in);
+	fseek(tga_in, start, SEEK_SET);
+	std::vector<unsigned char> packets(end > start ? end - start : 0);
+	size_t numRead = fread(packets.data(), sizeof(char), packets.size(), tga_in);
+	if (!decodeRLE_(packets.data(), numRead, data, numBytes, image->type == RGBA32_RASTER))
+	{
+		delete image;
+		fclose(tga_in);
+		return readFailed_(error, 16, "Truncated or corrupt run-length encoded data in image file %s", filePath);
+	}
+	if(head[17]&0x20)
+		flipRows_(data, image->height, image->bytesPerRow);
+	if(image->type == RGBA32_RASTER)
+		swapRGBA_(data, image->height, image->width);
+	fclose(tga_in) ;
+
+	//	A run-length encoded image has to be decoded up to the region anyway:
+	//	the region is copied out of the whole image
+	if (region != nullptr)
+	{
+		RasterImage* whole = image;
+		image = new RasterImage(region->width, region->height, imgType);
+		unsigned int firstRow = imgHeight - region->y - region->height;
+		for (unsigned int i = 0; i < region->height; i++)
+			memcpy((unsigned char*) image->raster + (size_t) i*image->bytesPerRow,
+				   (unsigned char*) whole->raster + (size_t) (firstRow + i)*whole->bytesPerRow + region->x*whole->bytesPerPixel,
+				   image->bytesPerRow);
+		delete whole;
+	}
+	return image;
+}	
+
+
+//---------------------------------------------------------------------*
+//	Function : writeTGA 
+//	Description :
+//	
+//	 This function write out an image of type TGA (24-bit color or 8-bit
+//	 gray), uncompressed or run-length encoded
+//	
+//	Return value: Error code (0 = no error)
+//----------------------------------------------------------------------*/ 
+ImageIOErrorCode writeTGA(const char* filePath, const RasterImage* image, bool compress)
+{
+	//--------------------------------
+	// open TARGA output file 
+	//--------------------------------
+	FILE* tga_out = fopen(filePath, "wb" );
+	if (tga_out == NULL)
+	{
+		printf("Cannot create image file %s \n", filePath);
+		return kCannotOpenWrite;
+	}
+
+	//	Yes, I know that I tell you over and over that cascading if-else tests
+	//	are bad style when testing an integral value, but here only two values
+	//	are supported.  If I ever add one more I'll use a switch, I promise.
+	
+	//------------------------------
+	//	Case of a color image
+	//------------------------------
+	if (image->type == RGBA32_RASTER)
+	{
+		//--------------------------------
+		// create the header (TARGA file)
+		//--------------------------------
+		char head[18] ;
+		head[0]  = 0 ;		  					// ID field length.
+		head[1]  = 0 ;		  					// Color map type.
+		head[2]  = compress ? 10 : 2 ;			// Image type: true color, uncompressed or RLE.
+		head[3]  = head[4] = 0 ;  				// First color map entry.
+		head[5]  = head[6] = 0 ;  				// Color map lenght.
+		head[7]  = 0 ;		  					// Color map entry size.
+		head[8]  = head[9] = 0 ;  				// Image X origin.
+		head[10] = head[11] = 0 ; 				// Image Y origin.
+		head[13] = (char) (image->width >> 8) ;		// Image width.
+		head[12] = (char) (image->width & 0x0FF) ;
+		head[15] = (char) (image->height >> 8) ;		// Image height.
+		head[14] = (char) (image->height & 0x0FF) ;
+		head[16] = 24 ;		 					// Bits per pixel.
+		head[17] = 0 ;		  					// Image descriptor bits ;
+		fwrite(head, sizeof(char), 18, tga_out );
+
+		unsigned char* data  = (unsigned char*) image->raster;
+		if (compress)
+			writeRLE_(image, tga_out);
+		else for(unsigned int i = 0; i < image->height; i++)
+		{
+			unsigned long offset = i*4*image->width;
+			for(unsigned int j = 0; j < image->width; j++)
+			{
+				fwrite(&data[offset+2], sizeof(char), 1, tga_out);
+				fwrite(&data[offset+1], sizeof(char), 1, tga_out);
+				fwrite(&data[offset], sizeof(char), 1, tga_out);
+				offset+=4;
+			}
+		}
+
+		fclose( tga_out ) ;
+	}
+	//------------------------------
+	//	Case of a gray-level image
+	//------------------------------
+	else if (image->type == GRAY_RASTER)
+	{
+		//--------------------------------
+		// create the header (TARGA file)
+		//--------------------------------
+		char	head[18] ;
+		head[0]  = 0 ;		  					// ID field length.
+		head[1]  = 0 ;		  					// Color map type.
+		head[2]  = compress ? 11 : 3 ;			// Image type: gray-level, uncompressed or RLE.
+		head[3]  = head[4] = 0 ;  				// First color map entry.
+		head[5]  = head[6] = 0 ;  				// Color map lenght.
+		head[7]  = 0 ;		  					// Color map entry size.
+		head[8]  = head[9] = 0 ;  				// Image X origin.
+		head[10] = head[11] = 0 ; 				// Image Y origin.
+		head[13] = (char) (image->width >> 8) ;		// Image width.
+		head[12] = (char) (image->width & 0x0FF) ;
+		head[15] = (char) (image->height >> 8) ;		// Image height.
+		head[14] = (char) (image->height & 0x0FF) ;
+		head[16] = 8 ;		 					// Bits per pixel.
+		head[17] = 0 ;		  					// Image descriptor bits ;
+		fwrite( head, sizeof(char), 18, tga_out );
+
+		unsigned char* data  = (unsigned char*) image->raster;
+		if (compress)
+			writeRLE_(image, tga_out);
+		else for(unsigned int i = 0; i < image->height; i++)
+		{
+			fwrite(&data[i*image->width], sizeof(char), image->width, tga_out);
+		}
+
+		fclose( tga_out ) ;
+	}
+	else
+	{
+		printf("Image type not supported for output in TGA format\n");
+		return kWrongFileType;
+	}
+	
+
+
+	return kNoIOerror;
+}	
+
@@ -0,0 +1,33 @@
+#ifndef	IMAGE_IO_TGA_H
+#define	IMAGE_IO_TGA_H
+
+#include <string>
+#include "RasterImage.h"
+
+/**	No-frills function that reads an image file in the TARGA (<tt>.tga</tt>) file format:
+ *	uncompressed (types 2 and 3) or run-length encoded (types 10 and 11), 24-bit color or
+ *	8-bit gray.  An uncompressed gray image is returned as a view of the
+ *	memory-mapped file (see mapRasterView) when the file can be mapped.  If the image
+ *	cannot be read (file not found, invalid format, etc.) the function simply
+ *	terminates execution, unless the caller asked for the error.  With a region, the
+ *	image read is only that region (an error if the region isn't inside the image);
+ *	for an uncompressed file, only the rows of the region are read.
+ *	@param	filePath	path to the file to read
+ *	@param	region		region of the image to read, or nullptr for all of it
+ *	@param	error		if not nullptr, receives the message of an error instead of
+ *						the function terminating (e.g. in the job server)
+ *	@return	 a properly initialized RasterImage storing the image read, or nullptr
+ *			 after an error reported in error
+ */
+RasterImage* readTGA(const char* filePath, const ImageRegion* region = nullptr, std::string* error = nullptr);
+
+/**	Writes an image file in the un-commented TARGA (<tt>.tga</tt>) file format.
+ *	@param	filePath	path to the file to write
+ *	@param  info		pointer to the RasterImage of the image to write into a .tga file.
+ *	@param	compress	if true, the image is run-length encoded (type 10 or 11), in
+ *						stripes of rows encoded in parallel
+ *	@return kNoIOerror if the image was written successfully, an error code otherwise.
+ */
+ImageIOErrorCode writeTGA(const char* filePath, const RasterImage* info, bool compress = false);
+
+#endif	//	IMAGE_IO_TGA_H
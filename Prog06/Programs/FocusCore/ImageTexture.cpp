@@ -0,0 +1,126 @@
+/**
+ * @file ImageTexture.cpp
+ * @brief Streams the display snapshot to an OpenGL texture
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <cstring>
+#include "ImageTexture.h"
+
+ImageTexture::ImageTexture(const DisplaySnapshot* theSnapshot)
+		:	snapshot(theSnapshot),
+			texture(0),
+			pixelBuffer(0),
+			format(theSnapshot->image()->type == RGBA32_RASTER ? GL_RGBA : GL_LUMINANCE),
+			dataType(theSnapshot->image()->type == DEEP_GRAY_RASTER ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE),
+			valueScale(theSnapshot->image()->type == DEEP_GRAY_RASTER && theSnapshot->image()->maxVal > 0 ?
+					   65535.0f / theSnapshot->image()->maxVal : 1.0f),
+			created(false)
+{
+}
+
+void ImageTexture::createGLObjects(void) {
+	const RasterImage* image = snapshot->image();
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	//	e.g. 12-bit samples (maxVal 4095) are stretched to the 16 bits of the
+	//	texture as they are uploaded; nothing else in the pane transfers pixels
+	glPixelTransferf(GL_RED_SCALE, valueScale);
+	//	the snapshot starts out blank, like the texture content we give here
+	GLint internalFormat = (format == GL_RGBA) ? GL_RGBA8 :
+						   (dataType == GL_UNSIGNED_SHORT) ? GL_LUMINANCE16 : GL_LUMINANCE8;
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat,
+				 image->width, image->height, 0, format, dataType, image->raster);
+
+	glGenBuffers(1, &pixelBuffer);
+	created = true;
+}
+
+size_t ImageTexture::upload(void) {
+	if (!created)
+		createGLObjects();
+
+	const std::vector<unsigned int>& tiles = snapshot->refreshedTiles();
+	if (tiles.empty())
+		return 0;
+
+	const RasterImage* image = snapshot->image();
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	//	When most of the image changed, one call for the whole image is
+	//	cheaper than a call per tile.  The tiles that weren't refreshed are
+	//	sent again as the display buffer holds them: the last checked copy,
+	//	never a torn one (DisplaySnapshot::refresh only commits checked tiles)
+	if (2 * tiles.size() > snapshot->numTiles()) {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image->width, image->height,
+						format, dataType, image->raster);
+		return static_cast<size_t>(image->bytesPerRow) * image->height;
+	}
+
+	//	Pack the dirty tiles one after the other in a fresh ("orphaned")
+	//	buffer, so we never wait for the GPU to finish with the previous one
+	size_t totalBytes = 0;
+	for (unsigned int t : tiles) {
+		unsigned int row, col, numRows, numCols;
+		snapshot->tileBounds(t, row, col, numRows, numCols);
+		totalBytes += static_cast<size_t>(numRows) * numCols * image->bytesPerPixel;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, totalBytes, NULL, GL_STREAM_DRAW);
+	unsigned char* packed = static_cast<unsigned char*>(glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
+	if (packed == NULL) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return 0;
+	}
+
+	const unsigned char* raster = static_cast<const unsigned char*>(image->raster);
+	size_t offset = 0;
+	for (unsigned int t : tiles) {
+		unsigned int row, col, numRows, numCols;
+		snapshot->tileBounds(t, row, col, numRows, numCols);
+		size_t rowBytes = static_cast<size_t>(numCols) * image->bytesPerPixel;
+		for (unsigned int r = row; r < row + numRows; r++) {
+			memcpy(packed + offset, raster + static_cast<size_t>(r) * image->bytesPerRow + col * image->bytesPerPixel, rowBytes);
+			offset += rowBytes;
+		}
+	}
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	//	With a buffer bound, the "pixels" argument is an offset into it
+	offset = 0;
+	for (unsigned int t : tiles) {
+		unsigned int row, col, numRows, numCols;
+		snapshot->tileBounds(t, row, col, numRows, numCols);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, col, row, numCols, numRows, format, dataType,
+						reinterpret_cast<const GLvoid*>(offset));
+		offset += static_cast<size_t>(numRows) * numCols * image->bytesPerPixel;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return totalBytes;
+}
+
+void ImageTexture::draw(GLfloat width, GLfloat height) const {
+	if (!created)
+		return;
+
+	//	Row 0 of the image is its bottom row, as for glDrawPixels
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glBegin(GL_QUADS);
+		glTexCoord2f(0.f, 0.f);	glVertex2f(0.f, 0.f);
+		glTexCoord2f(1.f, 0.f);	glVertex2f(width, 0.f);
+		glTexCoord2f(1.f, 1.f);	glVertex2f(width, height);
+		glTexCoord2f(0.f, 1.f);	glVertex2f(0.f, height);
+	glEnd();
+	glDisable(GL_TEXTURE_2D);
+}
@@ -0,0 +1,68 @@
+/**
+ * @file ImageTexture.h
+ * @brief Streams the display snapshot to an OpenGL texture
+ *
+ * Rather than sending the whole output image with glDrawPixels for every
+ * frame, the image lives in a texture and only the tiles refreshed since the
+ * previous frame are uploaded, packed into a pixel buffer object so the
+ * driver can copy them asynchronously.  The texture is then drawn as a
+ * quad scaled to the pane, which also replaces glPixelZoom.  Everything is
+ * uploaded from the display buffer of the snapshot, whose tiles are only
+ * replaced once checked, so a torn tile never reaches the screen.
+ *
+ * The GL objects are created on the first upload, since they belong to the
+ * context of the pane current at that time.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef IMAGE_TEXTURE_H
+#define IMAGE_TEXTURE_H
+
+#include "gl_frontEnd.h"
+#include "DisplaySnapshot.h"
+
+/**
+ * @class ImageTexture
+ * @brief Texture copy of a DisplaySnapshot, updated one dirty tile at a time.
+ */
+class ImageTexture {
+public:
+	/** @brief Creates an (as yet unallocated) texture for a snapshot. */
+	ImageTexture(const DisplaySnapshot* snapshot);
+
+	ImageTexture(const ImageTexture&) = delete;
+	ImageTexture& operator=(const ImageTexture&) = delete;
+
+	/**
+	 * @brief Uploads the tiles copied by the snapshot's last refresh.  Must be
+	 *	called with the pane's GL context current.
+	 * @return Number of bytes uploaded
+	 */
+	size_t upload(void);
+
+	/**
+	 * @brief Draws the texture as a quad with its lower-left corner at the origin.
+	 * @param width Width of the quad
+	 * @param height Height of the quad
+	 */
+	void draw(GLfloat width, GLfloat height) const;
+
+private:
+	/** @brief Allocates the texture and the pixel buffer (first upload only). */
+	void createGLObjects(void);
+
+	const DisplaySnapshot* snapshot;
+	GLuint texture;
+	GLuint pixelBuffer;
+	/** @brief GL_RGBA or GL_LUMINANCE, following the image type. */
+	GLenum format;
+	/** @brief GL_UNSIGNED_SHORT for a DEEP_GRAY_RASTER, GL_UNSIGNED_BYTE otherwise. */
+	GLenum dataType;
+	/** @brief Scale that brings the image's maxVal to white (1 for 8-bit images). */
+	GLfloat valueScale;
+	bool created;
+};
+
+#endif	//	IMAGE_TEXTURE_H
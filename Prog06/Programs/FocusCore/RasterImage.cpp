@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+//
+#include "RasterImage.h"
+
+RasterImage::RasterImage(unsigned int theWidth, unsigned int theHeight, ImageType theType)
+		:	width(theWidth),
+			height(theHeight),
+			type(theType),
+			ownsRaster(true),
+			mapping(nullptr),
+			mappingSize(0)
+{
+	initPixelSize_();
+	raster = (void*) calloc(height*width, bytesPerPixel);
+	initRaster2D_((unsigned char*) raster, bytesPerRow, true);
+}
+
+RasterImage::RasterImage(unsigned int theWidth, unsigned int theHeight, ImageType theType,
+						 const void* theData, size_t theStride, bool bottomUp,
+						 void* theMapping, size_t theMappingSize)
+		:	width(theWidth),
+			height(theHeight),
+			type(theType),
+			ownsRaster(false),
+			mapping(theMapping),
+			mappingSize(theMappingSize)
+{
+	initPixelSize_();
+	//	read-only: the pages are mapped without write access, or belong to another image
+	raster = const_cast<void*>(theData);
+	initRaster2D_((unsigned char*) raster, theStride, bottomUp);
+}
+
+void RasterImage::initPixelSize_(void)
+{
+	switch (type)
+	{
+		case RGBA32_RASTER:
+		bytesPerPixel = 4;
+		maxVal = 255;
+		break;
+
+		case GRAY_RASTER:
+		bytesPerPixel = 1;
+		maxVal = 255;
+		break;
+
+		case DEEP_GRAY_RASTER:
+		bytesPerPixel = 2;
+		maxVal = 65535;
+		break;
+
+		case FLOAT_RASTER:
+		bytesPerPixel = sizeof(float);
+		maxVal = 1;
+		break;
+
+		default:
+			bytesPerPixel = 0;
+			maxVal = 0;
+			break;
+	}
+	bytesPerRow = bytesPerPixel * width;
+}
+
+void RasterImage::initRaster2D_(unsigned char* data, size_t stride, bool bottomUp)
+{
+	//	Row i of the image is row i of the data, or row height-1-i if the data
+	//	starts with the top row
+	switch (type)
+	{
+		case RGBA32_RASTER:
+		case GRAY_RASTER:
+		{
+			unsigned char** r2D = new unsigned char*[height];
+			raster2D = (void*) r2D;
+			for (unsigned int i=0; i<height; i++)
+				r2D[i] = data + (bottomUp ? i : height-1-i)*stride;
+		}
+		break;
+
+		case DEEP_GRAY_RASTER:
+		{
+			unsigned short** r2D = new unsigned short*[height];
+			raster2D = (void*) r2D;
+			for (unsigned int i=0; i<height; i++)
+				r2D[i] = (unsigned short*) (data + (bottomUp ? i : height-1-i)*stride);
+		}
+		break;
+
+		case FLOAT_RASTER:
+		{
+			float** r2D = new float*[height];
+			raster2D = (void*) r2D;
+			for (unsigned int i=0; i<height; i++)
+				r2D[i] = (float*) (data + (bottomUp ? i : height-1-i)*stride);
+		}
+		break;
+
+		default:
+			raster2D = nullptr;
+			break;
+	}
+}
+
+RasterImage::~RasterImage(void) {
+	//	The raster was allocated with calloc, or is in a mapped file, or in another image
+	if (ownsRaster)
+		free(raster);
+	else if (mapping != nullptr)
+		munmap(mapping, mappingSize);
+
+	switch (type) {
+		case RGBA32_RASTER:
+		case GRAY_RASTER:
+			delete []((unsigned char**)raster2D);
+			break;
+
+		case DEEP_GRAY_RASTER:
+			delete []((unsigned short**)raster2D);
+			break;
+
+		case FLOAT_RASTER:
+			delete []((float**)raster2D);
+			break;
+
+		default:
+			break;
+	}
+}
+
+bool regionFits(const ImageRegion& region, unsigned int theWidth, unsigned int theHeight)
+{
+	return region.width > 0 && region.height > 0 &&
+		   region.x < theWidth && region.width <= theWidth - region.x &&
+		   region.y < theHeight && region.height <= theHeight - region.y;
+}
+
+RasterImage* mapRasterView(const char* filePath, size_t dataOffset, unsigned int theWidth,
+						   unsigned int theHeight, ImageType theType, bool bottomUp,
+						   const ImageRegion* region)
+{
+	size_t bytesPerPixel = (theType == RGBA32_RASTER) ? 4 : (theType == GRAY_RASTER) ? 1 :
+						   (theType == DEEP_GRAY_RASTER) ? 2 : sizeof(float);
+	size_t stride = (size_t) theWidth * bytesPerPixel;
+	size_t dataSize = stride * theHeight;
+
+	int fd = open(filePath, O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+	struct stat info;
+	void* theMapping = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && dataSize > 0 && (size_t) info.st_size >= dataOffset + dataSize)
+		theMapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (theMapping == MAP_FAILED)
+		return nullptr;
+
+	//	The rows of the region are together in the file: its top row is row y
+	//	of a file stored top row first, or row height-y-h of one stored bottom up
+	ImageRegion all;
+	all.width = theWidth;
+	all.height = theHeight;
+	const ImageRegion& r = (region != nullptr) ? *region : all;
+	size_t firstRow = bottomUp ? theHeight - r.y - r.height : r.y;
+	unsigned char* data = (unsigned char*) theMapping + dataOffset + firstRow*stride + r.x*bytesPerPixel;
+
+	//	start reading ahead now; the pages are only waited for when first touched
+	size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	size_t start = (dataOffset + firstRow*stride) / pageSize * pageSize;
+	madvise((unsigned char*) theMapping + start, dataOffset + (firstRow + r.height)*stride - start, MADV_WILLNEED);
+	return new RasterImage(r.width, r.height, theType, data, stride, bottomUp, theMapping, info.st_size);
+}
+
+RasterImage* regionView(const RasterImage* image, const ImageRegion& region)
+{
+	//	Rows of an image are evenly spaced, in either direction (see the view constructor)
+	unsigned char* const* rows = (unsigned char* const*) image->raster2D;
+	unsigned int bottom = image->height - region.y - region.height;
+	unsigned int top = bottom + region.height - 1;
+	size_t offset = (size_t) region.x * image->bytesPerPixel;
+	bool bottomUp = (image->height < 2) || (rows[1] > rows[0]);
+	size_t stride = (image->height < 2) ? image->bytesPerRow :
+					(size_t) (bottomUp ? rows[1] - rows[0] : rows[0] - rows[1]);
+	RasterImage* view = new RasterImage(region.width, region.height, image->type,
+										(bottomUp ? rows[bottom] : rows[top]) + offset, stride, bottomUp);
+	view->maxVal = image->maxVal;
+	return view;
+}
@@ -0,0 +1,242 @@
+#ifndef	RASTER_IMAGE_H
+#define	RASTER_IMAGE_H
+
+#include <stddef.h>
+#include <string.h>
+
+/**	Enum type for errors that can be encountered while reading or reading 
+ *	images
+ */
+enum ImageIOErrorCode
+{
+		kNoIOerror = 0,
+		//
+		kFilePathNull,
+		kFileNotFound,
+		kCannotOpenWrite,
+		kCannotOpenRead,
+		kWrongFileType,
+		kUnknownFileType,
+		kErrorReading,
+		kErrorWriting,
+		kEndOfFileError,
+		kMemAllocError
+};
+
+
+/**	This enumerated type is used by the image reading code.  You shouldn't have
+ *	to touch this
+ */
+enum ImageFileType
+{
+		kUnknownType = -1,
+		kTGA_COLOR,				//	24-bit color image
+		kTGA_GRAY,
+		kPPM,					//	24-bit color image
+		kPGM					//	8-bit gray-level image
+
+};
+
+/**	This is the enum type that refers to images loaded in memory, whether
+ *	they were read from a file, played from a movie, captured from a live
+ *	video stream, or the result of calculations.
+ *	Feel free to edit and add types you need for your project.
+ */
+enum ImageType
+{
+		/**	No type, for an image that got freed (no more raster)
+		 */
+		NO_RASTER,
+		 
+		/**	Color image with 4 bytes per pixel
+		 */
+		RGBA32_RASTER,
+
+		/**	Gray image with 1 byte per pixel
+		 */
+		GRAY_RASTER,
+
+		/**	Gray image with 2 bytes per pixel
+		 */
+		DEEP_GRAY_RASTER,
+
+		/**	Monochrome image (either gray or one color channel of a color image)
+		 *	stored in a float raster
+		 */
+		FLOAT_RASTER
+			
+};
+
+/**	A rectangle of an image (a region of interest), placed the way image tools
+ *	place a crop: x is counted from the left edge and y from the <b>top</b> edge
+ *	of the image, whatever the order in which its rows are stored
+ */
+struct ImageRegion {
+
+	/**	Column of the left edge of the region
+	 */
+	unsigned int x = 0;
+
+	/**	Row of the top edge of the region, counted from the top of the image
+	 */
+	unsigned int y = 0;
+
+	/**	Number of columns of the region (0 for the whole image)
+	 */
+	unsigned int width = 0;
+
+	/**	Number of rows of the region
+	 */
+	unsigned int height = 0;
+};
+
+/**	This is the data type to store all relevant information about an image.  After
+ *	some thought, I have decided to store the 1D and 2D rasters as void* rather than
+ *	having separate unsigned char and float pointers
+ */
+struct RasterImage {
+
+	//	disable default and copy constructor, and all move semantics
+	RasterImage(void) = delete;
+	RasterImage(const RasterImage& obj) = delete;
+	RasterImage(RasterImage&& obj) = delete;
+	RasterImage& operator=(RasterImage&& obj) = delete;
+
+	/**	Number of columns (width) of the image
+	 */
+	unsigned int width;
+
+	/**	Number of rows (height) of the image
+	 */
+	unsigned int height;
+
+	/**	Type of image stored
+	 */
+	ImageType type;
+	
+	/**	Maximum value for all fields of the image
+	 *	(only useful for DEEP_GRAY_RASTER and FLOAT_RASTER types)
+	 */
+	unsigned short maxVal;
+
+	/**	Pixel depth
+	 */
+	unsigned int bytesPerPixel;
+
+	/**	Number of bytes per row (which may be larger than
+	 *	bytesPerPixel * nbCols if rows are padded to a particular
+	 *	word length (e.g. multiple of 16 or 32))
+	 */
+	unsigned int bytesPerRow;
+
+	/**	Pointer to the image data, cast to a void* pointer.  To
+	 *	access the data, you would have to cast the pointer to the
+	 *	proper type, e.g.
+	 *	<ul>
+	 *		<li><tt>(int*) raster</tt></li>
+	 *		<li><tt>(unsigned char*) raster</tt></li>
+	 *		<li><tt>(int*) raster</tt></li>
+	 *		<li><tt>(float*) raster</tt></li>
+	 *	</ul>
+	 */
+	void* raster;
+
+	/* Similarly here the 2D raster was cast to a void* pointer
+	 *  and would need to be cast back to the proper type to be used, e.g.
+	 *	<ul>
+	 *		<li><tt>(int**) raster</tt></li>
+	 *		<li><tt>(unsigned char**) raster</tt></li>
+	 *		<li><tt>(int**) raster</tt></li>
+	 *		<li><tt>(float**) raster</tt></li>
+	 *	</ul>
+	 */
+	void* raster2D;
+	
+	/**	False for a view (see the second constructor): its pixels belong to a
+	 *	memory-mapped file, or to another image
+	 */
+	bool ownsRaster;
+	
+	/**	Start of the memory-mapped file a view reads its pixels from, or nullptr
+	 */
+	void* mapping;
+	
+	/**	Size of the memory-mapped file of a view
+	 */
+	size_t mappingSize;
+	
+	/**	Creates an image that owns a fresh raster, initialized to 0
+	 */
+	RasterImage(unsigned int theWidth, unsigned int theHeight, ImageType theType);
+	
+	/**	Creates a read-only view of pixels that are already in memory, in a memory-mapped
+	 *	file or in another image, rather than copying them.  The data is rows of
+	 *	bytesPerPixel * width bytes, stride bytes apart: a region of interest of a
+	 *	larger image is a view with the stride of that image, starting at the
+	 *	first pixel of the region.  When they are stored top row first (as in PNM
+	 *	files) raster2D simply lists them in reverse order, so <b>rows must be
+	 *	accessed through raster2D</b>: raster is then the last row of the image.
+	 *	Views are meant for the layers of a stack; the image writers expect an
+	 *	image that owns its raster.
+	 *	@param	theData			first row of the data
+	 *	@param	theStride		distance between the starts of two rows of the data, in bytes
+	 *	@param	bottomUp		true if the first row of the data is row 0 of the image
+	 *							(the order of TGA files), false if it is the last one
+	 *	@param	theMapping		start of the memory-mapped file, unmapped by the destructor
+	 *							(nullptr if the pixels belong to another image, which must
+	 *							outlive the view)
+	 *	@param	theMappingSize	size of the memory-mapped file
+	 */
+	RasterImage(unsigned int theWidth, unsigned int theHeight, ImageType theType,
+				const void* theData, size_t theStride, bool bottomUp,
+				void* theMapping = nullptr, size_t theMappingSize = 0);
+	
+	~RasterImage(void);
+	
+	private:
+	
+		/**	Sets bytesPerPixel, bytesPerRow and maxVal from the type
+		 */
+		void initPixelSize_(void);
+		
+		/**	Allocates raster2D over rows of data stored stride bytes apart
+		 */
+		void initRaster2D_(unsigned char* data, size_t stride, bool bottomUp);
+	
+};
+
+/**	Maps a file holding uncompressed pixels and creates a read-only view of them
+ *	(see the view constructor of RasterImage), so that the pixels are read
+ *	straight from the page cache, shared with any other process reading the
+ *	same file, instead of being copied.  With a region, the view only covers
+ *	the region, and only its rows are read ahead.
+ *	@param	filePath	path to the file
+ *	@param	dataOffset	position of the first pixel in the file (the size of its header)
+ *	@param	theWidth	number of columns of the image in the file
+ *	@param	theHeight	number of rows of the image in the file
+ *	@param	bottomUp	true if the first row of the file is row 0 of the image
+ *	@param	region		region of the image to view (must be inside it), or nullptr for all of it
+ *	@return	the view, or nullptr if the file can't be mapped or is too short
+ */
+RasterImage* mapRasterView(const char* filePath, size_t dataOffset, unsigned int theWidth,
+						   unsigned int theHeight, ImageType theType, bool bottomUp,
+						   const ImageRegion* region = nullptr);
+
+/**	Creates a view of a region of an image (see the view constructor of RasterImage)
+ *	@param	image	the image, which must outlive the view
+ *	@param	region	the region (must be inside the image)
+ *	@return	the view
+ */
+RasterImage* regionView(const RasterImage* image, const ImageRegion& region);
+
+/**	Checks that a region lies inside an image
+ *	@param	region	the region
+ *	@param	theWidth	number of columns of the image
+ *	@param	theHeight	number of rows of the image
+ *	@return	true if the region is not empty and inside the image
+ */
+bool regionFits(const ImageRegion& region, unsigned int theWidth, unsigned int theHeight);
+
+
+
+#endif	//	RASTER_IMAGE_H
@@ -0,0 +1,305 @@
+/**
+ * @file ThreadBackend.cpp
+ * @brief Interchangeable ways of running the focusing threads
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#ifdef FOCUS_HAVE_OPENMP
+#include <omp.h>
+#endif
+#ifdef FOCUS_HAVE_PAR
+#include <algorithm>
+#include <execution>
+#endif
+#include "ThreadBackend.h"
+
+/**
+ * @class PthreadBackend
+ * @brief One pthread per task.
+ */
+class PthreadBackend : public ThreadBackend {
+public:
+	void start(unsigned int numTasks, FocusTask task) override {
+		task_ = std::move(task);
+		threads_.resize(numTasks);
+		args_.resize(numTasks);
+		for (unsigned int i = 0; i < numTasks; i++) {
+			args_[i] = {&task_, i};
+			if (pthread_create(&threads_[i], NULL, runTask, &args_[i]) != 0) {
+				fprintf(stderr, "Could not create thread %u\n", i);
+				exit(14);
+			}
+		}
+	}
+
+	void wait(void) override {
+		for (pthread_t& thread : threads_)
+			pthread_join(thread, NULL);
+		threads_.clear();
+	}
+
+	const char* name(void) const override { return "pthread"; }
+
+private:
+	/** @brief Argument of a thread: the task and the index to call it with. */
+	struct TaskArg {
+		const FocusTask* task;
+		unsigned int index;
+	};
+
+	/** @brief Thread function: runs the task of its argument. */
+	static void* runTask(void* arg) {
+		TaskArg* taskArg = static_cast<TaskArg*>(arg);
+		(*taskArg->task)(taskArg->index);
+		return NULL;
+	}
+
+	FocusTask task_;
+	std::vector<pthread_t> threads_;
+	std::vector<TaskArg> args_;
+};
+
+/**
+ * @class StdThreadBackend
+ * @brief One std::thread per task.
+ */
+class StdThreadBackend : public ThreadBackend {
+public:
+	void start(unsigned int numTasks, FocusTask task) override {
+		task_ = std::move(task);
+		for (unsigned int i = 0; i < numTasks; i++)
+			threads_.emplace_back(task_, i);
+	}
+
+	void wait(void) override {
+		for (std::thread& thread : threads_)
+			thread.join();
+		threads_.clear();
+	}
+
+	const char* name(void) const override { return "thread"; }
+
+private:
+	FocusTask task_;
+	std::vector<std::thread> threads_;
+};
+
+/**
+ * @class JThreadBackend
+ * @brief One std::jthread per task, joined by its destructor.
+ *
+ * Nothing is joined by hand: wait destroys the threads, and so does the
+ * back-end if it is destroyed without waiting (where a std::thread still
+ * joinable would terminate the program).
+ */
+class JThreadBackend : public ThreadBackend {
+public:
+	void start(unsigned int numTasks, FocusTask task) override {
+		task_ = std::move(task);
+		for (unsigned int i = 0; i < numTasks; i++)
+			threads_.emplace_back(task_, i);
+	}
+
+	void wait(void) override { threads_.clear(); }
+
+	const char* name(void) const override { return "jthread"; }
+
+private:
+	//	(declared first, so destroyed after the threads that call it)
+	FocusTask task_;
+	std::vector<std::jthread> threads_;
+};
+
+/**
+ * @class ThreadPoolBackend
+ * @brief Persistent workers that pick the tasks of each run from a shared counter.
+ *
+ * The workers are created on the first run (and more are added if a later
+ * run has more tasks), then sleep on a condition variable between runs, so
+ * that a program focusing several stacks pays for thread creation once.
+ */
+class ThreadPoolBackend : public ThreadBackend {
+public:
+	~ThreadPoolBackend(void) override {
+		{
+			std::lock_guard<std::mutex> guard(mutex_);
+			stopping_ = true;
+		}
+		wake_.notify_all();
+		for (std::thread& worker : workers_)
+			worker.join();
+	}
+
+	void start(unsigned int numTasks, FocusTask task) override {
+		{
+			std::lock_guard<std::mutex> guard(mutex_);
+			task_ = std::move(task);
+			numTasks_ = numTasks;
+			nextTask_ = 0;
+			pending_ = numTasks;
+			while (workers_.size() < numTasks)
+				workers_.emplace_back(&ThreadPoolBackend::workerLoop, this);
+		}
+		wake_.notify_all();
+	}
+
+	void wait(void) override {
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_.wait(lock, [this] { return pending_ == 0; });
+	}
+
+	const char* name(void) const override { return "pool"; }
+
+private:
+	/** @brief Work of a pool thread: run tasks until the pool is destroyed. */
+	void workerLoop(void) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true) {
+			wake_.wait(lock, [this] { return stopping_ || nextTask_ < numTasks_; });
+			if (stopping_)
+				return;
+			unsigned int index = nextTask_++;
+			lock.unlock();
+			task_(index);
+			lock.lock();
+			if (--pending_ == 0)
+				done_.notify_all();
+		}
+	}
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::vector<std::thread> workers_;
+	FocusTask task_;
+	unsigned int numTasks_ = 0;
+	unsigned int nextTask_ = 0;
+	unsigned int pending_ = 0;
+	bool stopping_ = false;
+};
+
+/**
+ * @class CoordinatedBackend
+ * @brief Base of the back-ends whose parallel construct blocks the calling thread.
+ *
+ * The construct runs on a coordinating thread, so that start returns at once.
+ */
+class CoordinatedBackend : public ThreadBackend {
+public:
+	void start(unsigned int numTasks, FocusTask task) override {
+		coordinator_ = std::thread([this, numTasks, task = std::move(task)] { runAll(numTasks, task); });
+	}
+
+	void wait(void) override {
+		if (coordinator_.joinable())
+			coordinator_.join();
+	}
+
+protected:
+	/**
+	 * @brief Runs every task in parallel, returning once they all have
+	 * @param numTasks Number of tasks
+	 * @param task Work of each thread
+	 */
+	virtual void runAll(unsigned int numTasks, const FocusTask& task) = 0;
+
+private:
+	std::thread coordinator_;
+};
+
+#ifdef FOCUS_HAVE_OPENMP
+/**
+ * @class OpenMPBackend
+ * @brief An OpenMP parallel loop with one iteration per task.
+ */
+class OpenMPBackend : public CoordinatedBackend {
+public:
+	const char* name(void) const override { return "openmp"; }
+
+protected:
+	void runAll(unsigned int numTasks, const FocusTask& task) override {
+		#pragma omp parallel for num_threads(numTasks) schedule(static, 1)
+		for (unsigned int i = 0; i < numTasks; i++)
+			task(i);
+	}
+};
+#endif
+
+#ifdef FOCUS_HAVE_PAR
+/**
+ * @class ParallelAlgorithmBackend
+ * @brief std::for_each over the task indices with the parallel execution policy.
+ *
+ * par and not par_unseq: the tasks take locks, which the unsequenced policy
+ * forbids (two tasks could be interleaved on the same thread).
+ */
+class ParallelAlgorithmBackend : public CoordinatedBackend {
+public:
+	const char* name(void) const override { return "par"; }
+
+protected:
+	void runAll(unsigned int numTasks, const FocusTask& task) override {
+		std::vector<unsigned int> indices(numTasks);
+		std::iota(indices.begin(), indices.end(), 0u);
+		std::for_each(std::execution::par, indices.begin(), indices.end(),
+					  [&task](unsigned int i) { task(i); });
+	}
+};
+#endif
+
+ThreadBackend* makeThreadBackend(const char* name) {
+	if (strcmp(name, "pthread") == 0)
+		return new PthreadBackend();
+	if (strcmp(name, "thread") == 0)
+		return new StdThreadBackend();
+	if (strcmp(name, "jthread") == 0)
+		return new JThreadBackend();
+	if (strcmp(name, "pool") == 0)
+		return new ThreadPoolBackend();
+#ifdef FOCUS_HAVE_OPENMP
+	if (strcmp(name, "openmp") == 0)
+		return new OpenMPBackend();
+#endif
+#ifdef FOCUS_HAVE_PAR
+	if (strcmp(name, "par") == 0)
+		return new ParallelAlgorithmBackend();
+#endif
+	return nullptr;
+}
+
+const char* availableThreadBackends(void) {
+	return "pthread thread jthread pool"
+#ifdef FOCUS_HAVE_OPENMP
+		" openmp"
+#endif
+#ifdef FOCUS_HAVE_PAR
+		" par"
+#endif
+		;
+}
+
+ThreadBackend* selectThreadBackend(const char* requested, const char* defaultName) {
+	const char* name = requested;
+	if (name == nullptr)
+		name = getenv("FOCUS_BACKEND");
+	if (name == nullptr || name[0] == '\0')
+		name = defaultName;
+
+	ThreadBackend* backend = makeThreadBackend(name);
+	if (backend == nullptr) {
+		fprintf(stderr, "Back-end \"%s\" is not available; available: %s\n", name, availableThreadBackends());
+		exit(15);
+	}
+	return backend;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file ThreadBackend.h
+ * @brief Interchangeable ways of running the focusing threads
+ *
+ * A back-end runs task(0) ... task(n-1) in parallel, one task per focusing
+ * thread.  start returns at once (the GUI main loop has to run meanwhile),
+ * wait returns once every task has returned.  The back-ends are:
+ *
+ *	- pthread: one pthread_create per task
+ *	- thread:  one std::thread per task
+ *	- jthread: one std::jthread per task, joined by its destructor
+ *	- pool:    persistent workers, created once and reused from run to run
+ *	- openmp:  an OpenMP parallel loop (if built with OpenMP)
+ *	- par:     std::for_each with std::execution::par (if built with TBB)
+ *
+ * The openmp and par back-ends block the calling thread, so they are driven
+ * from a coordinating std::thread.  Tasks never wait for each other, so a
+ * back-end that runs fewer tasks at a time than asked (par, or an OpenMP
+ * runtime short of threads) is slower but still correct.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef THREAD_BACKEND_H
+#define THREAD_BACKEND_H
+
+#include <functional>
+
+/** @brief Work of one focusing thread, given the index of the thread. */
+using FocusTask = std::function<void(unsigned int threadIndex)>;
+
+/**
+ * @class ThreadBackend
+ * @brief Interface of a threading back-end.
+ */
+class ThreadBackend {
+public:
+	virtual ~ThreadBackend() = default;
+
+	/**
+	 * @brief Starts running task(0) ... task(numTasks-1) in parallel
+	 * @param numTasks Number of tasks (focusing threads)
+	 * @param task Work of each thread
+	 */
+	virtual void start(unsigned int numTasks, FocusTask task) = 0;
+
+	/**
+	 * @brief Waits until every task started by start has returned
+	 */
+	virtual void wait(void) = 0;
+
+	/**
+	 * @brief Name of the back-end, as given to --backend
+	 * @return e.g. "pool"
+	 */
+	virtual const char* name(void) const = 0;
+};
+
+/**
+ * @brief Creates a back-end from its name
+ * @param name Name of the back-end
+ * @return The back-end, or nullptr if the name is unknown or the back-end wasn't built
+ */
+ThreadBackend* makeThreadBackend(const char* name);
+
+/**
+ * @brief Names of the back-ends available in this build, separated by spaces
+ * @return e.g. "pthread thread jthread pool openmp par"
+ */
+const char* availableThreadBackends(void);
+
+/**
+ * @brief Creates the back-end requested by --backend, or else by the FOCUS_BACKEND
+ * environment variable, or else the program's default; exits if it isn't available
+ * @param requested Value of --backend (nullptr if absent)
+ * @param defaultName Back-end of the program when none is requested
+ * @return The back-end
+ */
+ThreadBackend* selectThreadBackend(const char* requested, const char* defaultName);
+
+#endif // THREAD_BACKEND_H
@@ -0,0 +1,291 @@
+/**
+ * @file ThreadTuning.cpp
+ * @brief Choice of the number of focusing threads ("auto" on the command line)
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ThreadTuning.h"
+#include "FocusEngine.h"
+#include "FocusStats.h"
+
+/** @brief Fewest rows of a band per thread, in windows. */
+static const int MIN_BAND_WINDOWS = 2;
+
+/** @brief Fewest pixel evaluations (pixels x layers) that make a thread worth starting. */
+static const double MIN_WORK_PER_THREAD = 256.0 * 1024.0;
+
+/** @brief Shortest duration of a calibration trial, in seconds. */
+static const double TRIAL_SECONDS = 0.02;
+
+/** @brief Number of trials of each thread count (the best one counts, to filter out noise). */
+static const int TRIALS_PER_COUNT = 3;
+
+/** @brief A thread count within this fraction of the best throughput is as good. */
+static const double CALIBRATION_TOLERANCE = 0.05;
+
+double cgroupCpuQuota(void) {
+	//	cgroup v2: "<quota> <period>", or "max <period>" for no quota
+	FILE* file = fopen("/sys/fs/cgroup/cpu.max", "r");
+	if (file != NULL) {
+		char quota[32] = "";
+		double period = 0.0;
+		int numRead = fscanf(file, "%31s %lf", quota, &period);
+		fclose(file);
+		if (numRead == 2 && strcmp(quota, "max") != 0 && period > 0.0)
+			return atof(quota) / period;
+		return 0.0;
+	}
+
+	//	cgroup v1: quota of -1 for none
+	const char* dirs[] = {"/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct"};
+	for (const char* dir : dirs) {
+		std::string base(dir);
+		FILE* quotaFile = fopen((base + "/cpu.cfs_quota_us").c_str(), "r");
+		FILE* periodFile = fopen((base + "/cpu.cfs_period_us").c_str(), "r");
+		double quota = -1.0, period = 0.0;
+		if (quotaFile != NULL && fscanf(quotaFile, "%lf", &quota) != 1)
+			quota = -1.0;
+		if (periodFile != NULL && fscanf(periodFile, "%lf", &period) != 1)
+			period = 0.0;
+		if (quotaFile != NULL)
+			fclose(quotaFile);
+		if (periodFile != NULL)
+			fclose(periodFile);
+		if (quotaFile != NULL || periodFile != NULL)
+			return (quota > 0.0 && period > 0.0) ? quota / period : 0.0;
+	}
+	return 0.0;
+}
+
+unsigned int availableCpus(void) {
+	unsigned int cpus = std::thread::hardware_concurrency();
+	if (cpus == 0)
+		cpus = 1;
+
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+		cpus = std::min<unsigned int>(cpus, std::max(CPU_COUNT(&allowed), 1));
+
+	double quota = cgroupCpuQuota();
+	if (quota > 0.0)
+		cpus = std::min<unsigned int>(cpus, std::max(1.0, std::ceil(quota)));
+	return cpus;
+}
+
+/**
+ * @brief Most threads worth using on a stack, given the CPUs and the amount of work
+ * @param ctx Context of the run
+ * @param cpus Number of CPUs available
+ * @return The bound, at least 1
+ */
+static unsigned int workBound(const FocusContext* ctx, unsigned int cpus) {
+	const RasterImage* image = ctx->imageOut;
+	double work = (double) image->width * image->height * ctx->imageStack.size();
+	unsigned int byRows = image->height / (MIN_BAND_WINDOWS * ctx->windowSize);
+	unsigned int byWork = (unsigned int) (work / MIN_WORK_PER_THREAD);
+	return std::max(1u, std::min({cpus, byRows, byWork}));
+}
+
+/**
+ * @brief Runs the contrast kernel over sample windows of the stack with a number of threads
+ * @param ctx Context of the run
+ * @param numThreads Number of threads of the trial
+ * @param windowsPerThread Number of windows each thread evaluates (over every layer)
+ * @return Throughput, in windows per second
+ */
+static double measureThroughput(const FocusContext* ctx, unsigned int numThreads, unsigned int windowsPerThread) {
+	const RasterImage* image = ctx->imageOut;
+	std::vector<std::thread> threads;
+	std::vector<double> sinks(numThreads);
+	uint64_t start = statsNow();
+	for (unsigned int i = 0; i < numThreads; i++) {
+		threads.emplace_back([&, i] {
+			//	Windows spread over the thread's own band, as in a real run
+			unsigned int bandHeight = std::max(image->height / numThreads, 1u);
+			unsigned int bandStart = std::min(i * bandHeight, image->height - 1);
+			double sum = 0.0;
+			for (unsigned int w = 0; w < windowsPerThread; w++) {
+				int row = bandStart + (w * 7919u) % bandHeight;
+				int col = (w * 104729u) % image->width;
+				for (const RasterImage* layer : ctx->imageStack)
+					sum += calculateWindowContrast(layer, std::min<int>(row, image->height - 1), col, ctx->windowSize);
+			}
+			sinks[i] = sum;
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	double seconds = std::max((statsNow() - start) * 1.0e-9, 1.0e-9);
+	return numThreads * windowsPerThread / seconds;
+}
+
+/**
+ * @brief Chooses the number of threads by timing the kernel with 1, 2, 4, ... maxThreads threads
+ * @param ctx Context of the run
+ * @param maxThreads Largest count to try
+ * @return The smallest count within CALIBRATION_TOLERANCE of the best throughput
+ */
+static unsigned int calibrate(const FocusContext* ctx, unsigned int maxThreads) {
+	//	Size the trials from a single-thread measurement
+	unsigned int windowsPerThread = 64;
+	double rate = measureThroughput(ctx, 1, windowsPerThread);
+	windowsPerThread = std::max(64u, (unsigned int) (rate * TRIAL_SECONDS));
+
+	std::vector<unsigned int> candidates;
+	for (unsigned int count = 1; count < maxThreads; count *= 2)
+		candidates.push_back(count);
+	candidates.push_back(maxThreads);
+
+	std::vector<double> rates;
+	double bestRate = 0.0;
+	for (unsigned int count : candidates) {
+		double countRate = 0.0;
+		for (int trial = 0; trial < TRIALS_PER_COUNT; trial++)
+			countRate = std::max(countRate, measureThroughput(ctx, count, windowsPerThread));
+		rates.push_back(countRate);
+		bestRate = std::max(bestRate, countRate);
+	}
+	for (size_t k = 0; k < candidates.size(); k++) {
+		if (rates[k] >= (1.0 - CALIBRATION_TOLERANCE) * bestRate)
+			return candidates[k];
+	}
+	return maxThreads;
+}
+
+/**
+ * @brief Path of the file of saved choices of this host
+ * @return The path, or an empty string if there is no home directory
+ */
+static std::string tuningFilePath(void) {
+	std::string dir;
+	const char* configHome = getenv("XDG_CONFIG_HOME");
+	const char* home = getenv("HOME");
+	if (configHome != NULL && configHome[0] != '\0')
+		dir = configHome;
+	else if (home != NULL && home[0] != '\0')
+		dir = std::string(home) + "/.config";
+	else
+		return "";
+	char host[256] = "localhost";
+	gethostname(host, sizeof(host) - 1);
+	return dir + "/focus-stacking/threads-" + host + ".conf";
+}
+
+/**
+ * @brief Key of a stack's size class in the file of saved choices
+ * @param ctx Context of the run
+ * @param maxThreads Bound on the number of threads (changes with the CPUs available)
+ * @return The key, e.g. "window=11 pixels=2^19 layers=5 max=8"
+ */
+static std::string tuningKey(const FocusContext* ctx, unsigned int maxThreads) {
+	char key[96];
+	double pixels = (double) ctx->imageOut->width * ctx->imageOut->height;
+	snprintf(key, sizeof(key), "window=%d pixels=2^%d layers=%zu max=%u", ctx->windowSize,
+			 (int) std::lround(std::log2(pixels)), ctx->imageStack.size(), maxThreads);
+	return key;
+}
+
+/**
+ * @brief Reads the lines of the file of saved choices
+ * @param path Path of the file
+ * @param key Key of the size class of the stack
+ * @param lines Receives the lines of the other size classes
+ * @return The "<threads>" text saved for the key, or an empty string
+ */
+static std::string readTuningFile(const std::string& path, const std::string& key, std::vector<std::string>& lines) {
+	std::string saved;
+	FILE* file = fopen(path.c_str(), "r");
+	if (file == NULL)
+		return saved;
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		std::string text(line);
+		if (!text.empty() && text.back() == '\n')
+			text.pop_back();
+		if (text.compare(0, key.size() + 3, key + " = ") == 0)
+			saved = text.substr(key.size() + 3);
+		else
+			lines.push_back(text);
+	}
+	fclose(file);
+	return saved;
+}
+
+/**
+ * @brief Saves the choice for a size class in the file of saved choices
+ *
+ * Shards and batches may tune at the same time: the file is read again and
+ * rewritten under a lock (another process's new lines are kept), to a
+ * temporary file renamed into place (a reader never sees half a file).
+ * Failing to save is not an error (e.g. a read-only home).
+ * @param path Path of the file
+ * @param key Key of the size class of the stack
+ * @param numThreads The choice
+ */
+static void saveTuning(const std::string& path, const std::string& key, unsigned int numThreads) {
+	std::string dir = path.substr(0, path.rfind('/'));
+	mkdir(dir.substr(0, dir.rfind('/')).c_str(), 0755);
+	mkdir(dir.c_str(), 0755);
+	int lockFile = open((path + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+	if (lockFile < 0)
+		return;
+	flock(lockFile, LOCK_EX);
+
+	std::vector<std::string> lines;
+	readTuningFile(path, key, lines);
+	lines.push_back(key + " = " + std::to_string(numThreads));
+	std::string tempPath = path + "." + std::to_string(getpid()) + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "w");
+	if (file != NULL) {
+		bool written = true;
+		for (const std::string& line : lines)
+			written &= fprintf(file, "%s\n", line.c_str()) > 0;
+		written = (fclose(file) == 0) && written;
+		if (!written || rename(tempPath.c_str(), path.c_str()) != 0)
+			remove(tempPath.c_str());
+	}
+
+	flock(lockFile, LOCK_UN);
+	close(lockFile);
+}
+
+unsigned int autotuneThreads(const FocusContext* ctx, bool recalibrate) {
+	unsigned int cpus = availableCpus();
+	unsigned int maxThreads = workBound(ctx, cpus);
+	std::string path = tuningFilePath();
+	std::string key = tuningKey(ctx, maxThreads);
+
+	//	The file holds one "<key> = <threads>" line per size class
+	if (!path.empty() && !recalibrate) {
+		std::vector<std::string> lines;
+		unsigned int saved;
+		std::string text = readTuningFile(path, key, lines);
+		if (sscanf(text.c_str(), "%u", &saved) == 1 && saved >= 1 && saved <= maxThreads) {
+			fprintf(stderr, "Threads: %u (saved for this host in %s)\n", saved, path.c_str());
+			return saved;
+		}
+	}
+
+	unsigned int numThreads = (maxThreads == 1) ? 1 : calibrate(ctx, maxThreads);
+	fprintf(stderr, "Threads: %u (%s, %u CPUs available, at most %u for this stack)\n",
+			numThreads, (maxThreads == 1) ? "no choice" : "calibrated", cpus, maxThreads);
+	if (!path.empty())
+		saveTuning(path, key, numThreads);
+	return numThreads;
+}
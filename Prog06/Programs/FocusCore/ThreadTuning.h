@@ -0,0 +1,48 @@
+/**
+ * @file ThreadTuning.h
+ * @brief Choice of the number of focusing threads ("auto" on the command line)
+ *
+ * The number of threads is bounded by the CPUs the process can actually use
+ * (hardware threads, affinity mask, cgroup CPU quota) and by the amount of
+ * work in the stack, then chosen by a short calibration: the contrast kernel
+ * runs over sample windows of the stack with 1, 2, 4, ... threads, and the
+ * smallest count within a few percent of the best throughput wins.  The
+ * result is saved per host, in $XDG_CONFIG_HOME/focus-stacking (or
+ * ~/.config/focus-stacking), for stacks of the same size class, so that
+ * later runs skip the calibration.  Processes tuning at the same time (shards,
+ * batches) take turns through a lock file next to it, and the file is
+ * replaced with a rename, so no entry is lost or torn.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef THREAD_TUNING_H
+#define THREAD_TUNING_H
+
+struct FocusContext;
+
+/**
+ * @brief Number of CPUs the process can use
+ *
+ * The smallest of std::thread::hardware_concurrency, the size of the
+ * affinity mask and the cgroup CPU quota (rounded up), at least 1.
+ * @return The number of CPUs
+ */
+unsigned int availableCpus(void);
+
+/**
+ * @brief CPU quota of the cgroup of the process (cgroup v2 cpu.max, or v1 cfs quota)
+ * @return The quota in CPUs, or 0 if there is none
+ */
+double cgroupCpuQuota(void);
+
+/**
+ * @brief Chooses the number of focusing threads for a stack
+ * @param ctx Context of the run (its stack must be loaded)
+ * @param recalibrate If true, calibrate even if the host has a saved choice
+ * @return The number of threads
+ */
+unsigned int autotuneThreads(const FocusContext* ctx, bool recalibrate);
+
+#endif // THREAD_TUNING_H
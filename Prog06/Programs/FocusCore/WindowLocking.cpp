@@ -0,0 +1,55 @@
+/**
+ * @file WindowLocking.cpp
+ * @brief Sizing of the grid of region locks
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include "WindowLocking.h"
+
+/**
+ * @brief Parses one side of a lock grid: digits only, from 1 to MAX_LOCK_GRID_SIDE
+ * @param text Start of the side
+ * @param side Receives the side
+ * @return Pointer past the digits, or nullptr if the side isn't valid
+ */
+static const char* parseGridSide(const char* text, int& side) {
+	if (!isdigit((unsigned char) text[0]))
+		return nullptr;
+	char* end;
+	long value = strtol(text, &end, 10);
+	if (value < 1 || value > MAX_LOCK_GRID_SIDE)
+		return nullptr;
+	side = (int) value;
+	return end;
+}
+
+bool parseLockGridSpec(const char* spec, int& rows, int& cols) {
+	const char* end = parseGridSide(spec, rows);
+	if (end == nullptr || *end != 'x')
+		return false;
+	end = parseGridSide(end + 1, cols);
+	return end != nullptr && *end == '\0';
+}
+
+LockGrid chooseLockGrid(int width, int height, int windowSize, const char* gridSpec) {
+	//	The coverage tiles are windowSize on a side
+	int tilesY = (height + windowSize - 1) / windowSize;
+	int tilesX = (width + windowSize - 1) / windowSize;
+	LockGrid grid;
+	if (gridSpec == nullptr || !parseLockGridSpec(gridSpec, grid.rows, grid.cols)) {
+		grid.rows = std::min(tilesY, MAX_LOCK_GRID_SIDE);
+		grid.cols = std::min(tilesX, MAX_LOCK_GRID_SIDE);
+	}
+
+	//	Regions are whole tiles, so the writes of a tile take a single lock
+	grid.regionHeight = (tilesY + grid.rows - 1) / grid.rows * windowSize;
+	grid.regionWidth = (tilesX + grid.cols - 1) / grid.cols * windowSize;
+	grid.rows = (height + grid.regionHeight - 1) / grid.regionHeight;
+	grid.cols = (width + grid.regionWidth - 1) / grid.regionWidth;
+	return grid;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file WindowLocking.h
+ * @brief Locking policies taken around the writes of the output pixels of a window
+ *
+ * A worker locks the rectangle of output pixels it is about to write, writes
+ * them, then unlocks.  How the rectangle maps to locks is the policy: a single
+ * lock for the whole image (Version2) or a grid of region locks (Version3).
+ * Version1 writes only the rows of its own band and needs no policy at all.
+ *
+ * Versions 2 and 3 don't need one either: each coverage tile belongs to a
+ * single thread, which writes only the pixels of that tile, and the coverage
+ * bits are set atomically, so no data is shared between the writers.  The
+ * policies stay on the write path only to demonstrate the two ways of
+ * locking; what their counters measure is the cost of the locking itself
+ * (SingleLock serializes every write; two RegionLocks threads only wait
+ * when unrelated tiles fall in the same region), not contention for data.
+ *
+ * The policies are templates over the mutex type, so the std::thread and the
+ * pthread programs share them (PthreadMutex adapts a pthread_mutex_t).
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#ifndef WINDOW_LOCKING_H
+#define WINDOW_LOCKING_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <pthread.h>
+#include "FocusStats.h"
+
+/** @brief Largest number of locks a window can need (a 2x2 neighborhood of regions). */
+const int MAX_WINDOW_REGIONS = 4;
+
+/** @brief Largest number of rows (or columns) of regions accepted by --lock-grid. */
+const int MAX_LOCK_GRID_SIDE = 1024;
+
+/**
+ * @struct HeldLocks
+ * @brief The locks a worker took for one window, to hand back to unlock.
+ */
+struct HeldLocks {
+	/** @brief Number of locks held. */
+	int count;
+
+	/** @brief Indices of the locks held, in the order they were taken. */
+	int indices[MAX_WINDOW_REGIONS];
+
+	/** @brief Time at which each lock was acquired (for the hold time counters). */
+	uint64_t acquiredAt[MAX_WINDOW_REGIONS];
+};
+
+/**
+ * @class WindowLocking
+ * @brief Interface of a locking policy for the output image.
+ */
+class WindowLocking {
+public:
+	virtual ~WindowLocking() = default;
+
+	/**
+	 * @brief Takes every lock covering a rectangle of output pixels
+	 * @param rowMin First row of the rectangle
+	 * @param rowMax Last row of the rectangle
+	 * @param colMin First column of the rectangle
+	 * @param colMax Last column of the rectangle
+	 * @param stats Counters of the calling thread
+	 * @param held Receives the locks taken
+	 */
+	virtual void lock(int rowMin, int rowMax, int colMin, int colMax, ThreadStats* stats, HeldLocks& held) = 0;
+
+	/**
+	 * @brief Releases the locks taken by lock, in reverse order
+	 * @param stats Counters of the calling thread
+	 * @param held The locks returned by lock
+	 */
+	virtual void unlock(ThreadStats* stats, HeldLocks& held) = 0;
+
+	/**
+	 * @brief Short description of the policy, for the state pane
+	 * @return e.g. "Lock grid: 4x6"
+	 */
+	virtual std::string describe(void) const = 0;
+};
+
+/**
+ * @class PthreadMutex
+ * @brief A pthread_mutex_t with the lock/try_lock/unlock interface of std::mutex.
+ */
+class PthreadMutex {
+public:
+	PthreadMutex(void) { pthread_mutex_init(&mutex_, NULL); }
+	~PthreadMutex(void) { pthread_mutex_destroy(&mutex_); }
+	PthreadMutex(const PthreadMutex&) = delete;
+	PthreadMutex& operator=(const PthreadMutex&) = delete;
+
+	void lock(void) { pthread_mutex_lock(&mutex_); }
+	bool try_lock(void) { return pthread_mutex_trylock(&mutex_) == 0; }
+	void unlock(void) { pthread_mutex_unlock(&mutex_); }
+
+private:
+	pthread_mutex_t mutex_;
+};
+
+/**
+ * @class SingleLock
+ * @brief One lock for the whole output image.
+ */
+template <class Mutex>
+class SingleLock : public WindowLocking {
+public:
+	void lock(int, int, int, int, ThreadStats* stats, HeldLocks& held) override {
+		held.count = 1;
+		held.indices[0] = 0;
+		held.acquiredAt[0] = lockCounted(mutex_, stats);
+	}
+
+	void unlock(ThreadStats* stats, HeldLocks& held) override {
+		unlockCounted(mutex_, stats, held.acquiredAt[0]);
+	}
+
+	std::string describe(void) const override {
+		return "Lock: single";
+	}
+
+private:
+	Mutex mutex_;
+};
+
+/**
+ * @struct LockGrid
+ * @brief Size of a grid of region locks.
+ */
+struct LockGrid {
+	/** @brief Number of rows of regions. */
+	int rows;
+
+	/** @brief Number of columns of regions. */
+	int cols;
+
+	/** @brief Height of a region, in rows (never smaller than the window). */
+	int regionHeight;
+
+	/** @brief Width of a region, in columns (never smaller than the window). */
+	int regionWidth;
+};
+
+/**
+ * @brief Parses the size of a lock grid, "RxC" (e.g. "8x12")
+ * @param spec The size
+ * @param rows Receives the number of rows of regions
+ * @param cols Receives the number of columns of regions
+ * @return false unless both are integers from 1 to MAX_LOCK_GRID_SIDE, with nothing around them
+ */
+bool parseLockGridSpec(const char* spec, int& rows, int& cols);
+
+/**
+ * @brief Sizes the grid of region locks for an image
+ *
+ * Regions are made of whole coverage tiles, so the writes of a tile take a
+ * single lock.  Since a tile has a single writer, two threads only wait for
+ * each other when their tiles share a region: the automatic grid has one
+ * region per tile (up to MAX_LOCK_GRID_SIDE on a side), so they never do.
+ * Forcing a coarser grid with "RxC" shows what sharing locks between
+ * unrelated tiles costs, on the lock counters.
+ * @param width Width of the image
+ * @param height Height of the image
+ * @param windowSize Side of the windows written (and of the coverage tiles)
+ * @param gridSpec "RxC" to force the grid size (already checked by parseLockGridSpec), or nullptr
+ *		  to choose it automatically
+ * @return The grid, with regions of whole tiles
+ */
+LockGrid chooseLockGrid(int width, int height, int windowSize, const char* gridSpec);
+
+/**
+ * @class RegionLocks
+ * @brief A grid of region locks, each alone on its cache line.
+ *
+ * The regions are at least as large as the window, so a window overlaps at
+ * most a 2x2 neighborhood of them.  They are always taken in increasing index
+ * (row-major) order, so two workers can't deadlock.
+ */
+template <class Mutex>
+class RegionLocks : public WindowLocking {
+public:
+	/**
+	 * @brief Builds the grid (see chooseLockGrid for the parameters)
+	 */
+	RegionLocks(int width, int height, int windowSize, const char* gridSpec)
+		:	grid_(chooseLockGrid(width, height, windowSize, gridSpec)),
+			regions_(new PaddedMutex[grid_.rows * grid_.cols]) {
+	}
+
+	~RegionLocks(void) override {
+		delete[] regions_;
+	}
+
+	RegionLocks(const RegionLocks&) = delete;
+	RegionLocks& operator=(const RegionLocks&) = delete;
+
+	void lock(int rowMin, int rowMax, int colMin, int colMax, ThreadStats* stats, HeldLocks& held) override {
+		held.count = 0;
+		for (int regionRow = rowMin / grid_.regionHeight; regionRow <= rowMax / grid_.regionHeight; regionRow++) {
+			for (int regionCol = colMin / grid_.regionWidth; regionCol <= colMax / grid_.regionWidth; regionCol++) {
+				held.indices[held.count++] = regionRow * grid_.cols + regionCol;
+			}
+		}
+		for (int k = 0; k < held.count; k++) {
+			held.acquiredAt[k] = lockCounted(regions_[held.indices[k]].mutex, stats);
+		}
+	}
+
+	void unlock(ThreadStats* stats, HeldLocks& held) override {
+		for (int k = held.count - 1; k >= 0; k--) {
+			unlockCounted(regions_[held.indices[k]].mutex, stats, held.acquiredAt[k]);
+		}
+	}
+
+	std::string describe(void) const override {
+		char text[32];
+		snprintf(text, sizeof(text), "Lock grid: %dx%d", grid_.rows, grid_.cols);
+		return text;
+	}
+
+	/** @brief Size of the grid. */
+	const LockGrid& grid(void) const { return grid_; }
+
+private:
+	/**
+	 * @struct PaddedMutex
+	 * @brief A mutex alone on its cache line, so that neighboring region locks don't false-share.
+	 */
+	struct alignas(CACHE_LINE_SIZE) PaddedMutex {
+		Mutex mutex;
+	};
+
+	/** @brief Size of the grid. */
+	LockGrid grid_;
+
+	/** @brief Region locks, rows x cols in row-major order. */
+	PaddedMutex* regions_;
+};
+
+#endif // WINDOW_LOCKING_H
@@ -18,12 +18,7 @@
 //
 #include "RasterImage.h"
 #include "gl_frontEnd.h"
-
-const extern int MAX_NUM_MESSAGES;
-const extern int MAX_LENGTH_MESSAGE;
-
-extern unsigned int numLiveFocusingThreads;
-extern RasterImage imageOut;
+#include "FocusStats.h"
 
 //---------------------------------------------------------------------------
 //  Private functions' prototypes
@@ -52,7 +47,10 @@ const float kTextColor[4] = {1.f, 1.f, 1.f, 1.f};
 
 const int   INIT_WIN_X = 100,
             INIT_WIN_Y = 40;
-const int   msecs = 20;
+//	The timer runs at the frame rate while something changes, and slows
+//	down to IDLE_MSECS while nothing does
+unsigned int maxFrameRate = 50;
+const int   IDLE_MSECS = 250;
 
 //	I hate the fact that the gcc compiler on Ubuntu doesn't let
 //	me cascade the definition of my constants.  This goes agaisnt
@@ -172,7 +170,7 @@ void drawState(int numMessages, char** message)
 
 	//	display info about number of live threads
 	char infoStr[256];
-	sprintf(infoStr, "Live Threads: %d", numLiveFocusingThreads);
+	sprintf(infoStr, "Live Threads: %u", numLiveFocusingThreads.load());
 	displayTextualInfo(infoStr, LEFT_MARGIN, 7*STATE_PANE_HEIGHT/8, 2);
 }
 
@@ -300,12 +298,46 @@ void myImagePaneMouse(int button, int state, int x, int y)
 }
 
 
+//	The argument is the delay that brought us here.  Each pane is only
+//	redrawn when its content changed: the image when the workers have written
+//	(or --resume restored) pixels since the last frame, the state pane when
+//	its text changed.
 void myTimeCB(int d)
 {
-	//	Nothing to do but display the current output image
-    myDisplay();
+	static uint64_t lastPixelsWritten = 0;
+	static unsigned int lastLiveThreads = 0;
+	int frameMsecs = 1000 / maxFrameRate;
+	bool changed = false;
+
+	StatsSnapshot stats = gatherStats();
+	uint64_t pixelsWritten = stats.pixelsWritten + stats.pixelsRestored;
+	if (pixelsWritten != lastPixelsWritten)
+	{
+		lastPixelsWritten = pixelsWritten;
+		glutPostWindowRedisplay(gSubwindow[IMAGE_PANE]);
+		changed = true;
+	}
+
+	unsigned int liveThreads = numLiveFocusingThreads.load();
+	if (updateState() || liveThreads != lastLiveThreads)
+	{
+		lastLiveThreads = liveThreads;
+		glutPostWindowRedisplay(gSubwindow[STATE_PANE]);
+		changed = true;
+	}
 
-	glutTimerFunc(msecs, myTimeCB, 0);
+	int nextMsecs = changed ? frameMsecs : 2*d;
+	if (nextMsecs < frameMsecs)
+		nextMsecs = frameMsecs;
+	if (nextMsecs > IDLE_MSECS)
+		nextMsecs = IDLE_MSECS;
+	glutTimerFunc(nextMsecs, myTimeCB, nextMsecs);
+}
+
+void setMaxFrameRate(unsigned int framesPerSecond)
+{
+	if (framesPerSecond > 0 && framesPerSecond <= 1000)
+		maxFrameRate = framesPerSecond;
 }
 
 
@@ -326,7 +358,7 @@ void initializeFrontEnd(int argc, char** argv, RasterImage* imageOut)
 	glutReshapeFunc(myResize);
 	glutMouseFunc(myMouse);
 	glutKeyboardFunc(myKeyboard);
-	glutTimerFunc(msecs, myTimeCB, 0);
+	glutTimerFunc(1000 / maxFrameRate, myTimeCB, 1000 / maxFrameRate);
 
 	//	create the two panes as glut subwindows
 	gSubwindow[IMAGE_PANE] = glutCreateSubWindow(gMainWindow,
@@ -26,6 +26,8 @@
 		#include <GL/gl.h>
 	#endif
 #elif defined(__linux__)
+	//	for the OpenGL 1.5/2.1 buffer functions (pixel buffer objects)
+	#define GL_GLEXT_PROTOTYPES
 	#include <GL/glut.h>
 #else
 	#error unknown OS
@@ -42,9 +44,13 @@ void drawState(int numMessages, char** message);
 
 void initializeFrontEnd(int argc, char** argv, RasterImage* imageOut);
 
-//	Functions implemented in main.cpp
+//	Sets the maximum number of frames drawn per second (call before initializeFrontEnd)
+void setMaxFrameRate(unsigned int framesPerSecond);
+
+//	Functions implemented in FocusApp.cpp
 void displayImage(GLfloat scaleX, GLfloat scaleY);
 void displayState(void);
+bool updateState(void);
 void handleKeyboardEvent(unsigned char c, int x, int y);
 
 #endif // GL_FRONT_END_H
@@ -0,0 +1,28 @@
+/**
+ * @file main.cpp
+ * @brief Job server: focuses the stacks that clients send over a Unix domain socket
+ * 
+ * A long-running process that keeps its threads, and the layers of recent
+ * stacks, from one job to the next (see FocusServer.h); Tools/focusClient
+ * sends it jobs.  It has no GUI.
+ * 
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include "FocusServer.h"
+
+/**
+ * @brief Main function of the application.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return Exit status.
+ */
+int main(int argc, char** argv)
+{
+    ServerOptions options;
+    if (!parseServerOptions(argc, argv, options))
+        return 1;
+
+    return runFocusServer(options);
+}
@@ -0,0 +1,29 @@
+/**
+ * @file main.cpp
+ * @brief Shard program: focuses one band of rows of a stack, as one of several processes
+ *
+ * Each process of a sharded run reads only the rows of its band (and the
+ * halo its windows reach), focuses them as Version1 does, and writes them
+ * with their depth map to a partial file next to the output; focusMerge
+ * then assembles the partials (see FocusShard.h).  It has no GUI.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include "FocusShard.h"
+
+/**
+ * @brief Main function of the application.
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return Exit status.
+ */
+int main(int argc, char** argv)
+{
+    ShardOptions options;
+    if (!parseShardOptions(argc, argv, options))
+        return 1;
+
+    return runShard(options);
+}
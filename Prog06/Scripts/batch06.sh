@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -lt 4 ]; then
+    echo "Usage: $0 <path_to_focusBatch> <num_threads> <stacks_folder> <output_folder> [job options...]"
+    echo "Focuses every subfolder of <stacks_folder> into <output_folder>/<subfolder>.tga"
+    exit 1
+fi
+
+# Assign arguments to variables
+BATCH_PATH=$1
+NUM_THREADS=$2
+STACKS_FOLDER=$3
+OUTPUT_FOLDER=$4
+shift 4
+
+# Write the manifest: one job per subfolder (but the output folder)
+mkdir -p "$OUTPUT_FOLDER"
+MANIFEST="$OUTPUT_FOLDER/manifest.txt"
+: > "$MANIFEST"
+for STACK in "$STACKS_FOLDER"/*/; do
+    NAME=$(basename "$STACK")
+    if [ "$(cd "$STACK" && pwd)" = "$(cd "$OUTPUT_FOLDER" && pwd)" ]; then
+        continue
+    fi
+    echo "${STACK%/} $OUTPUT_FOLDER/$NAME.tga" >> "$MANIFEST"
+done
+
+# Execute the batch (options after the output folder apply to every job)
+"$BATCH_PATH" "$@" "$NUM_THREADS" "$MANIFEST"
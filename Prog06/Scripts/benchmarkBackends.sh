@@ -0,0 +1,77 @@
+#!/bin/bash
+
+# Compares the threading back-ends head to head: every headless program runs
+# on a synthetic stack with every back-end, several times, and the median
+# focusing time (from the programs' summary line) is reported.  The fastest
+# back-end overall is the one to put in FOCUS_BACKEND on this machine.
+# Run ./build.sh first.
+
+if [ "$#" -gt 4 ]; then
+    echo "Usage: $0 [num_threads] [runs] [\"width height\"] [num_layers]"
+    exit 1
+fi
+
+NUM_THREADS=${1:-$(nproc)}
+RUNS=${2:-5}
+SIZE=${3:-"1024 768"}
+NUM_LAYERS=${4:-6}
+BUILDS=../Builds
+BACKENDS="pthread thread jthread pool openmp par"
+
+if [ ! -x "$BUILDS/makeTestStack" ]; then
+    echo "$BUILDS/makeTestStack not found: run ./build.sh first"
+    exit 1
+fi
+
+STACK_DIR=$(mktemp -d)
+trap 'rm -rf "$STACK_DIR"' EXIT
+"$BUILDS/makeTestStack" "$STACK_DIR" $SIZE "$NUM_LAYERS" || exit 1
+
+# Median of the focusing times of RUNS runs, or nothing if the back-end isn't built
+median_time() {
+    local program=$1 backend=$2
+    local times=()
+    for ((run = 0; run < RUNS; run++)); do
+        local summary
+        summary=$("$BUILDS/$program" --backend="$backend" "$NUM_THREADS" "$STACK_DIR/out.tga" \
+                  "$STACK_DIR"/layer_*.tga 2>&1 >/dev/null) || return
+        times+=("$(echo "$summary" | sed -n 's/.* threads, \([0-9.]*\) s:.*/\1/p')")
+    done
+    printf "%s\n" "${times[@]}" | sort -g | sed -n "$(( (RUNS + 1) / 2 ))p"
+}
+
+echo "$NUM_THREADS threads, $RUNS runs, $SIZE x $NUM_LAYERS layers (median seconds)"
+printf "%-22s" "program"
+for backend in $BACKENDS; do
+    printf "%9s" "$backend"
+done
+echo
+
+declare -A totals
+for program in C++_Version1 C++_Version2 C++_Version3 P_Version1 P_Version2 P_Version3; do
+    [ -x "$BUILDS/${program}_headless" ] || continue
+    printf "%-22s" "${program}_headless"
+    for backend in $BACKENDS; do
+        time=$(median_time "${program}_headless" "$backend")
+        if [ -z "$time" ]; then
+            printf "%9s" "-"
+            totals[$backend]="n/a"
+        else
+            printf "%9s" "$time"
+            [ "${totals[$backend]}" != "n/a" ] && totals[$backend]=$(awk "BEGIN { print ${totals[$backend]:-0} + $time }")
+        fi
+    done
+    echo
+done
+
+best=""
+for backend in $BACKENDS; do
+    total=${totals[$backend]}
+    [ -z "$total" ] || [ "$total" = "n/a" ] && continue
+    if [ -z "$best" ] || awk "BEGIN { exit !($total < ${totals[$best]}) }"; then
+        best=$backend
+    fi
+done
+if [ -n "$best" ]; then
+    echo "Fastest back-end overall: $best (export FOCUS_BACKEND=$best to make it the default)"
+fi
@@ -0,0 +1,74 @@
+#!/bin/bash
+
+# Compares sizes of the Version3 lock grid on the lock counters: the headless
+# Version3 programs run on a synthetic stack with the automatic grid (one
+# region per tile) and with forced coarser grids, several times, and the
+# median focusing time and share of the threads' time spent waiting for
+# region locks (from the programs' summary line) are reported.
+# Every tile has a single writer, so the locks guard no shared data (see
+# WindowLocking.h): the wait measured is the cost of unrelated tiles sharing
+# a region, which a coarser grid makes more likely, not contention for data.
+# Run ./build.sh first.
+
+if [ "$#" -gt 5 ]; then
+    echo "Usage: $0 [num_threads] [runs] [\"width height\"] [num_layers] [\"grids\"]"
+    exit 1
+fi
+
+NUM_THREADS=${1:-$(nproc)}
+RUNS=${2:-5}
+SIZE=${3:-"1024 768"}
+NUM_LAYERS=${4:-6}
+GRIDS=${5:-"auto 1x1 2x2 4x4 8x8 16x16 32x32"}
+BUILDS=../Builds
+
+if [ ! -x "$BUILDS/makeTestStack" ]; then
+    echo "$BUILDS/makeTestStack not found: run ./build.sh first"
+    exit 1
+fi
+
+STACK_DIR=$(mktemp -d)
+trap 'rm -rf "$STACK_DIR"' EXIT
+"$BUILDS/makeTestStack" "$STACK_DIR" $SIZE "$NUM_LAYERS" || exit 1
+
+# Median focusing time and lock wait share of RUNS runs ("seconds percent")
+median_run() {
+    local program=$1 grid=$2
+    local option=()
+    [ "$grid" != "auto" ] && option=(--lock-grid="$grid")
+    local times=() waits=()
+    for ((run = 0; run < RUNS; run++)); do
+        local summary
+        summary=$("$BUILDS/$program" --order=random "${option[@]}" "$NUM_THREADS" "$STACK_DIR/out.tga" \
+                  "$STACK_DIR"/layer_*.tga 2>&1 >/dev/null) || return
+        times+=("$(echo "$summary" | sed -n 's/.* threads, \([0-9.]*\) s:.*/\1/p')")
+        waits+=("$(echo "$summary" | sed -n 's/.*lock wait \([0-9.]*\)%.*/\1/p')")
+    done
+    local middle=$(( (RUNS + 1) / 2 ))
+    echo "$(printf "%s\n" "${times[@]}" | sort -g | sed -n "${middle}p")" \
+         "$(printf "%s\n" "${waits[@]}" | sort -g | sed -n "${middle}p")"
+}
+
+echo "$NUM_THREADS threads, $RUNS runs, $SIZE x $NUM_LAYERS layers (median seconds / lock wait %)"
+printf "%-22s" "grid"
+for program in C++_Version3 P_Version3; do
+    printf "%24s" "${program}_headless"
+done
+echo
+
+for grid in $GRIDS; do
+    printf "%-22s" "$grid"
+    for program in C++_Version3 P_Version3; do
+        if [ ! -x "$BUILDS/${program}_headless" ]; then
+            printf "%24s" "-"
+            continue
+        fi
+        read -r time wait <<< "$(median_run "${program}_headless" "$grid")"
+        if [ -z "$time" ]; then
+            printf "%24s" "failed"
+        else
+            printf "%24s" "$time s / $wait %"
+        fi
+    done
+    echo
+done
@@ -1,5 +1,12 @@
 #!/bin/bash
 
+# Builds the six programs, their headless variants, the batch driver, the
+# job server and the shard programs with CMake (Release: -O3 -march=native) and copies the
+# executables to ../Builds.
+# Extra arguments are passed on to CMake, for example:
+#   ./build.sh -DFOCUS_LTO=ON
+#   ./build.sh -DFOCUS_MARCH=x86-64-v3 -DFOCUS_GUI=OFF
+
 # Detecting the platform
 platform=$(uname)
 echo "Detected platform: $platform"
@@ -10,12 +17,25 @@ if [ ! -d "../Builds" ]; then
     mkdir ../Builds
 fi
 
-g++ -Wall -std=c++20 ./../Programs/C++_thread/Version1/*.cpp -lGL -lglut -o ./../Builds/C++_Version1
-g++ -Wall -std=c++20 ./../Programs/C++_thread/Version2/*.cpp -lGL -lglut -o ./../Builds/C++_Version2
-g++ -Wall -std=c++20 ./../Programs/C++_thread/Version3/*.cpp -lGL -lglut -o ./../Builds/C++_Version3
-g++ -Wall -std=c++20 ./../Programs/pthread/Version1/*.cpp -lGL -lglut -o ./../Builds/P_Version1
-g++ -Wall -std=c++20 ./../Programs/pthread/Version2/*.cpp -lGL -lglut -o ./../Builds/P_Version2
-g++ -Wall -std=c++20 ./../Programs/pthread/Version3/*.cpp -lGL -lglut -o ./../Builds/P_Version3
+if [ "$platform" = "Darwin" ]; then
+    numJobs=$(sysctl -n hw.ncpu)
+else
+    numJobs=$(nproc)
+fi
 
-chmod +x ./../Builds
+cmake -S .. -B ../Builds/cmake "$@" || exit 1
+cmake --build ../Builds/cmake -j "$numJobs" || exit 1
 
+for program in C++_Version1 C++_Version2 C++_Version3 P_Version1 P_Version2 P_Version3; do
+    for variant in "$program" "${program}_headless"; do
+        if [ -f "../Builds/cmake/$variant" ]; then
+            cp "../Builds/cmake/$variant" ../Builds/
+        fi
+    done
+done
+for tool in focusBatch focusServer focusClient focusShard focusMerge; do
+    cp "../Builds/cmake/$tool" ../Builds/
+done
+cp ../Builds/cmake/makeTestStack ../Builds/
+
+chmod +x ./../Builds
@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -lt 6 ]; then
+    echo "Usage: $0 <path_to_builds> <num_shards> <threads_per_shard> <output_path> <depth_map_path> <input_folder> [shard options...]"
+    echo "Focuses the stack of <input_folder> with <num_shards> local focusShard processes, then merges their bands"
+    exit 1
+fi
+
+# Assign arguments to variables
+BUILDS_PATH=$1
+NUM_SHARDS=$2
+NUM_THREADS=$3
+OUTPUT_PATH=$4
+DEPTH_MAP_PATH=$5
+INPUT_FOLDER=$6
+shift 6
+
+# The layers of the stack, in name order
+shopt -s nullglob
+LAYERS=("$INPUT_FOLDER"/*.{tga,ppm,pgm,pnm})
+if [ "${#LAYERS[@]}" -eq 0 ]; then
+    echo "No image in $INPUT_FOLDER"
+    exit 1
+fi
+IFS=$'\n' LAYERS=($(printf '%s\n' "${LAYERS[@]}" | sort))
+unset IFS
+
+# Start every shard, as the hosts of a farm would
+PIDS=()
+for SHARD in $(seq 1 "$NUM_SHARDS"); do
+    "$BUILDS_PATH/focusShard" "$@" "$NUM_THREADS" "$SHARD/$NUM_SHARDS" "$OUTPUT_PATH" "${LAYERS[@]}" &
+    PIDS+=($!)
+done
+
+# Wait for all of them; merge only if they all succeeded
+FAILED=0
+for PID in "${PIDS[@]}"; do
+    wait "$PID" || FAILED=1
+done
+if [ "$FAILED" -ne 0 ]; then
+    echo "Some shards failed: not merging"
+    exit 1
+fi
+
+"$BUILDS_PATH/focusMerge" "$NUM_SHARDS" "$OUTPUT_PATH" "$DEPTH_MAP_PATH"
@@ -0,0 +1,74 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <path_to_builds> <work_folder>"
+    echo "Checks that a batch goes on past the stacks that can't be focused, and fails only their jobs"
+    exit 1
+fi
+
+# Assign arguments to variables
+BUILDS_PATH=$1
+WORK_FOLDER=$2
+
+rm -rf "$WORK_FOLDER"
+mkdir -p "$WORK_FOLDER"/{good,corrupt,mismatched,deep,empty,small,out}
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/good" 250 190 4 > /dev/null || exit 1
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/small" 120 90 2 > /dev/null || exit 1
+"$BUILDS_PATH/makeTestStack" --deep "$WORK_FOLDER/deep" 120 90 2 > /dev/null || exit 1
+
+# A layer cut short, and a stack of two sizes
+cp "$WORK_FOLDER"/good/*.tga "$WORK_FOLDER/corrupt/"
+head -c 3000 "$WORK_FOLDER/good/layer_01.tga" > "$WORK_FOLDER/corrupt/layer_01.tga"
+cp "$WORK_FOLDER"/good/*.tga "$WORK_FOLDER/mismatched/"
+cp "$WORK_FOLDER/small/layer_00.tga" "$WORK_FOLDER/mismatched/layer_04.tga"
+
+# Good jobs around every kind of bad one (a 16-bit stack can't go to a TGA file)
+MANIFEST="$WORK_FOLDER/manifest.txt"
+cat > "$MANIFEST" << EOF
+$WORK_FOLDER/good $WORK_FOLDER/out/first.tga
+$WORK_FOLDER/corrupt $WORK_FOLDER/out/corrupt.tga
+$WORK_FOLDER/mismatched $WORK_FOLDER/out/mismatched.tga
+$WORK_FOLDER/deep $WORK_FOLDER/out/deep.tga
+$WORK_FOLDER/empty $WORK_FOLDER/out/empty.tga
+$WORK_FOLDER/good $WORK_FOLDER/out/last.tga --blend
+EOF
+
+"$BUILDS_PATH/focusBatch" 2 "$MANIFEST" 2> "$WORK_FOLDER/batch.log"
+STATUS=$?
+
+FAILED=0
+if [ $STATUS -ne 20 ]; then
+    echo "The batch exited with status $STATUS, not 20 (some jobs failed)"
+    FAILED=1
+fi
+if ! grep -q "^6 jobs, 4 failed$" "$WORK_FOLDER/batch.log"; then
+    echo "The batch didn't count 4 failed jobs out of 6"
+    FAILED=1
+fi
+for LINE in 2 3 4 5; do
+    if ! grep -q "^$MANIFEST:$LINE: " "$WORK_FOLDER/batch.log"; then
+        echo "The failure of the job of line $LINE wasn't reported"
+        FAILED=1
+    fi
+done
+
+# The good jobs, before and after the bad ones, are focused as by a program
+"$BUILDS_PATH/C++_Version1_headless" 2 "$WORK_FOLDER/first.tga" "$WORK_FOLDER"/good/*.tga 2> /dev/null || exit 1
+"$BUILDS_PATH/C++_Version1_headless" --blend 2 "$WORK_FOLDER/last.tga" "$WORK_FOLDER"/good/*.tga 2> /dev/null || exit 1
+for NAME in first last; do
+    if ! cmp -s "$WORK_FOLDER/$NAME.tga" "$WORK_FOLDER/out/$NAME.tga"; then
+        echo "The $NAME job wasn't focused as C++_Version1 focuses its stack"
+        FAILED=1
+    fi
+done
+for NAME in corrupt mismatched deep empty; do
+    if [ -e "$WORK_FOLDER/out/$NAME.tga" ]; then
+        echo "The failed $NAME job wrote an output"
+        FAILED=1
+    fi
+done
+if [ $FAILED -ne 0 ]; then
+    cat "$WORK_FOLDER/batch.log"
+fi
+exit $FAILED
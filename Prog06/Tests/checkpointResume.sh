@@ -0,0 +1,81 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <path_to_builds> <work_folder>"
+    echo "Checks that a run killed after a checkpoint resumes to the output of an uninterrupted run"
+    exit 1
+fi
+
+# Assign arguments to variables
+BUILDS_PATH=$1
+WORK_FOLDER=$2
+
+# The stack, and another one of the same size
+rm -rf "$WORK_FOLDER"
+mkdir -p "$WORK_FOLDER/stack" "$WORK_FOLDER/other"
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/stack" 1200 900 5 > /dev/null || exit 1
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/other" 1200 900 4 > /dev/null || exit 1
+
+FAILED=0
+# Starts a run with checkpoints, and kills it once its first checkpoint is
+# written: <program> <output_path> [options...].  The run is let go only a
+# few milliseconds at a time (between SIGSTOP and SIGCONT), so it is far
+# from done when its writer, which polls the coverage every 100 ms of wall
+# time, writes the checkpoint, however fast the machine
+interrupted_run() {
+    local program=$1 output=$2
+    shift 2
+    "$BUILDS_PATH/${program}_headless" "$@" --checkpoint-coverage=1 1 "$output" "$WORK_FOLDER"/stack/*.tga \
+        > /dev/null 2>&1 &
+    local pid=$!
+    while [ ! -e "${output%.tga}.checkpoint.coverage" ] && kill -STOP $pid 2> /dev/null; do
+        sleep 0.05
+        kill -CONT $pid 2> /dev/null
+        sleep 0.001
+    done
+    kill -9 $pid 2> /dev/null
+    wait $pid 2> /dev/null
+    [ -e "${output%.tga}.checkpoint.coverage" ]
+}
+
+for PROGRAM in C++_Version1 C++_Version3; do
+    for BLEND in "" --blend; do
+        RUN="$PROGRAM$BLEND"
+        REFERENCE="$WORK_FOLDER/$RUN-reference.tga"
+        OUTPUT="$WORK_FOLDER/$RUN.tga"
+        "$BUILDS_PATH/${PROGRAM}_headless" $BLEND 1 "$REFERENCE" "$WORK_FOLDER"/stack/*.tga 2> /dev/null || exit 1
+        if ! interrupted_run $PROGRAM "$OUTPUT" $BLEND; then
+            echo "$RUN finished before it could be interrupted"
+            FAILED=1
+            continue
+        fi
+
+        # A checkpoint of another computation is refused, and kept
+        "$BUILDS_PATH/${PROGRAM}_headless" $( [ -z "$BLEND" ] && echo --blend ) --resume 1 "$OUTPUT" \
+            "$WORK_FOLDER"/stack/*.tga > /dev/null 2>&1
+        STATUS_BLEND=$?
+        "$BUILDS_PATH/${PROGRAM}_headless" $BLEND --resume 1 "$OUTPUT" "$WORK_FOLDER"/other/*.tga > /dev/null 2>&1
+        STATUS_STACK=$?
+        if [ $STATUS_BLEND -ne 18 ] || [ $STATUS_STACK -ne 18 ]; then
+            echo "$RUN resumed a checkpoint of another computation (statuses $STATUS_BLEND and $STATUS_STACK, not 18)"
+            FAILED=1
+        fi
+
+        "$BUILDS_PATH/${PROGRAM}_headless" $BLEND --resume 1 "$OUTPUT" "$WORK_FOLDER"/stack/*.tga \
+            2> "$WORK_FOLDER/$RUN.log" || exit 1
+        if ! grep -q "^Resuming .* from its checkpoint" "$WORK_FOLDER/$RUN.log"; then
+            echo "$RUN didn't resume from its checkpoint"
+            FAILED=1
+        fi
+        if ! cmp -s "$REFERENCE" "$OUTPUT"; then
+            echo "$RUN resumed from a checkpoint differs from the uninterrupted run"
+            FAILED=1
+        fi
+        if compgen -G "$WORK_FOLDER/$RUN.checkpoint*" > /dev/null; then
+            echo "$RUN left its checkpoint behind"
+            FAILED=1
+        fi
+    done
+done
+exit $FAILED
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <path_to_builds> <work_folder>"
+    echo "Checks that the output is the same with or without the focus map cache, cold or warm"
+    exit 1
+fi
+
+# Assign arguments to variables
+BUILDS_PATH=$1
+WORK_FOLDER=$2
+
+rm -rf "$WORK_FOLDER"
+mkdir -p "$WORK_FOLDER/stack"
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/stack" 250 190 4 > /dev/null || exit 1
+
+FAILED=0
+for PROGRAM in C++_Version1 C++_Version2 P_Version3; do
+    for BLEND in "" --blend; do
+        RUN="$PROGRAM$BLEND"
+        CACHE="$WORK_FOLDER/cache-$RUN"
+        REFERENCE="$WORK_FOLDER/$RUN.tga"
+        "$BUILDS_PATH/${PROGRAM}_headless" $BLEND 2 "$REFERENCE" "$WORK_FOLDER"/stack/*.tga 2> /dev/null || exit 1
+
+        # The first run computes the maps into the cache, the second reads them
+        for STATE in cold warm; do
+            OUTPUT="$WORK_FOLDER/$RUN-$STATE.tga"
+            "$BUILDS_PATH/${PROGRAM}_headless" $BLEND --map-cache="$CACHE" 2 "$OUTPUT" "$WORK_FOLDER"/stack/*.tga \
+                2> "$WORK_FOLDER/$RUN-$STATE.log" || exit 1
+            if ! cmp -s "$REFERENCE" "$OUTPUT"; then
+                echo "$RUN with a $STATE cache differs from the run without a cache"
+                FAILED=1
+            fi
+        done
+        if ! grep -q "^Focus maps: 0 of 4 from the cache" "$WORK_FOLDER/$RUN-cold.log" ||
+           ! grep -q "^Focus maps: 4 of 4 from the cache" "$WORK_FOLDER/$RUN-warm.log"; then
+            echo "$RUN didn't compute the maps into the cache, then read them from it"
+            FAILED=1
+        fi
+    done
+done
+exit $FAILED
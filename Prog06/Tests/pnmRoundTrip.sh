@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <path_to_builds> <work_folder>"
+    echo "Checks that 8-bit and 16-bit PPM/PGM files read back to the pixels they were written from"
+    exit 1
+fi
+
+# Assign arguments to variables
+BUILDS_PATH=$1
+WORK_FOLDER=$2
+PROGRAM="$BUILDS_PATH/C++_Version1_headless"
+
+rm -rf "$WORK_FOLDER"
+mkdir -p "$WORK_FOLDER/tga" "$WORK_FOLDER/ppm" "$WORK_FOLDER/deep"
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/tga" 250 190 4 > /dev/null || exit 1
+"$BUILDS_PATH/makeTestStack" --deep "$WORK_FOLDER/deep" 250 190 4 > /dev/null || exit 1
+
+FAILED=0
+# Prints a message and fails the test unless two files are identical
+same() {
+    if ! cmp -s "$1" "$2"; then
+        echo "$3"
+        FAILED=1
+    fi
+}
+
+# A stack of a single layer focuses to that layer, so the programs convert
+# one format to the other.  8 bits: the color layers to PPM and back
+for LAYER in "$WORK_FOLDER"/tga/*.tga; do
+    NAME=$(basename "$LAYER" .tga)
+    "$PROGRAM" 1 "$WORK_FOLDER/ppm/$NAME.ppm" "$LAYER" 2> /dev/null || exit 1
+    "$PROGRAM" 1 "$WORK_FOLDER/$NAME-again.ppm" "$WORK_FOLDER/ppm/$NAME.ppm" 2> /dev/null || exit 1
+    same "$WORK_FOLDER/ppm/$NAME.ppm" "$WORK_FOLDER/$NAME-again.ppm" "$NAME: a PPM file reads back to other pixels"
+    "$PROGRAM" 1 "$WORK_FOLDER/$NAME-back.tga" "$WORK_FOLDER/ppm/$NAME.ppm" 2> /dev/null || exit 1
+    same "$LAYER" "$WORK_FOLDER/$NAME-back.tga" "$NAME: TGA to PPM to TGA changes the pixels"
+done
+
+# 8-bit gray: a PGM file made of the bytes of a layer
+{ printf 'P5\n250 190\n255\n'; tail -c 47500 "$WORK_FOLDER/tga/layer_00.tga"; } > "$WORK_FOLDER/gray.pgm"
+"$PROGRAM" 1 "$WORK_FOLDER/gray-again.pgm" "$WORK_FOLDER/gray.pgm" 2> /dev/null || exit 1
+same "$WORK_FOLDER/gray.pgm" "$WORK_FOLDER/gray-again.pgm" "An 8-bit PGM file reads back to other pixels"
+
+# 16 bits: the 12-bit layers and the focused stack keep their samples and maximum value
+for LAYER in "$WORK_FOLDER"/deep/*.pgm; do
+    NAME=$(basename "$LAYER" .pgm)
+    "$PROGRAM" 1 "$WORK_FOLDER/$NAME-again.pgm" "$LAYER" 2> /dev/null || exit 1
+    same "$LAYER" "$WORK_FOLDER/$NAME-again.pgm" "$NAME: a 16-bit PGM file reads back to other pixels"
+done
+"$PROGRAM" 2 "$WORK_FOLDER/deep.pgm" "$WORK_FOLDER"/deep/*.pgm 2> /dev/null || exit 1
+"$PROGRAM" 1 "$WORK_FOLDER/deep-again.pgm" "$WORK_FOLDER/deep.pgm" 2> /dev/null || exit 1
+same "$WORK_FOLDER/deep.pgm" "$WORK_FOLDER/deep-again.pgm" "The focused 16-bit stack reads back to other pixels"
+if [ "$(head -c 15 "$WORK_FOLDER/deep.pgm" | tr '\n' ' ')" != "P5 250 190 4095" ]; then
+    echo "The focused 16-bit stack lost its maximum value"
+    FAILED=1
+fi
+
+# A 16-bit stack can't be written to an 8-bit format
+"$PROGRAM" 2 "$WORK_FOLDER/deep.tga" "$WORK_FOLDER"/deep/*.pgm > /dev/null 2>&1
+if [ $? -ne 17 ]; then
+    echo "A 16-bit stack was focused to a TGA file"
+    FAILED=1
+fi
+
+# Nor can 16-bit layers of different maximum values (12 and 16 bits) be focused together
+{ printf 'P5\n250 190\n65535\n'; tail -c 95000 "$WORK_FOLDER/deep/layer_01.pgm"; } > "$WORK_FOLDER/wide.pgm"
+"$PROGRAM" 2 "$WORK_FOLDER/mixed.pgm" "$WORK_FOLDER/deep/layer_00.pgm" "$WORK_FOLDER/wide.pgm" > /dev/null 2>&1
+if [ $? -ne 13 ] || [ -e "$WORK_FOLDER/mixed.pgm" ]; then
+    echo "16-bit layers of different maximum values were focused together"
+    FAILED=1
+fi
+
+# The whole stack and a region of it, read from PPM or TGA files
+for ROI in "" --roi=97x61+13+120; do
+    "$PROGRAM" $ROI 2 "$WORK_FOLDER/tga$ROI.tga" "$WORK_FOLDER"/tga/*.tga 2> /dev/null || exit 1
+    "$PROGRAM" $ROI 2 "$WORK_FOLDER/ppm$ROI.tga" "$WORK_FOLDER"/ppm/*.ppm 2> /dev/null || exit 1
+    same "$WORK_FOLDER/tga$ROI.tga" "$WORK_FOLDER/ppm$ROI.tga" "The PPM stack focuses to other pixels ${ROI:-(whole image)}"
+done
+exit $FAILED
@@ -0,0 +1,56 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <path_to_builds> <work_folder>"
+    echo "Checks that run-length encoded TGA files decode to the pixels they were encoded from"
+    exit 1
+fi
+
+# Assign arguments to variables
+BUILDS_PATH=$1
+WORK_FOLDER=$2
+PROGRAM="$BUILDS_PATH/C++_Version1_headless"
+
+# The same stack, uncompressed and run-length encoded (sides that aren't
+# multiples of a packet, so runs end at the ends of rows)
+rm -rf "$WORK_FOLDER"
+mkdir -p "$WORK_FOLDER/plain" "$WORK_FOLDER/rle"
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/plain" 250 190 4 > /dev/null || exit 1
+"$BUILDS_PATH/makeTestStack" --rle "$WORK_FOLDER/rle" 250 190 4 > /dev/null || exit 1
+
+FAILED=0
+# Prints a message and fails the test unless two files are identical
+same() {
+    if ! cmp -s "$1" "$2"; then
+        echo "$3"
+        FAILED=1
+    fi
+}
+
+# A stack of a single layer focuses to that layer, so the programs convert
+# one format to the other
+for LAYER in "$WORK_FOLDER"/plain/*.tga; do
+    NAME=$(basename "$LAYER" .tga)
+    if [ "$(od -An -tu1 -j2 -N1 "$WORK_FOLDER/rle/$NAME.tga" | tr -d ' ')" != "10" ]; then
+        echo "$WORK_FOLDER/rle/$NAME.tga isn't run-length encoded"
+        FAILED=1
+    fi
+
+    # Decoding: the encoded layer, written back uncompressed
+    "$PROGRAM" 1 "$WORK_FOLDER/$NAME-decoded.tga" "$WORK_FOLDER/rle/$NAME.tga" 2> /dev/null || exit 1
+    same "$LAYER" "$WORK_FOLDER/$NAME-decoded.tga" "$NAME: the encoded layer decodes to other pixels"
+
+    # Encoding: the plain layer, encoded by the program, then decoded
+    "$PROGRAM" --rle 1 "$WORK_FOLDER/$NAME-encoded.tga" "$LAYER" 2> /dev/null || exit 1
+    "$PROGRAM" 1 "$WORK_FOLDER/$NAME-round.tga" "$WORK_FOLDER/$NAME-encoded.tga" 2> /dev/null || exit 1
+    same "$LAYER" "$WORK_FOLDER/$NAME-round.tga" "$NAME: encoding then decoding changes the pixels"
+done
+
+# The whole stack and a region of it, read from either
+for ROI in "" --roi=97x61+13+120; do
+    "$PROGRAM" $ROI 2 "$WORK_FOLDER/plain$ROI.tga" "$WORK_FOLDER"/plain/*.tga 2> /dev/null || exit 1
+    "$PROGRAM" $ROI 2 "$WORK_FOLDER/rle$ROI.tga" "$WORK_FOLDER"/rle/*.tga 2> /dev/null || exit 1
+    same "$WORK_FOLDER/plain$ROI.tga" "$WORK_FOLDER/rle$ROI.tga" "The encoded stack focuses to other pixels ${ROI:-(whole image)}"
+done
+exit $FAILED
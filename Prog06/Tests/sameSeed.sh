@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <path_to_builds> <work_folder>"
+    echo "Checks that the window versions give the same output for a seed, whatever the thread schedule"
+    exit 1
+fi
+
+# Assign arguments to variables
+BUILDS_PATH=$1
+WORK_FOLDER=$2
+
+# A stack whose sides aren't multiples of the window, so it has partial tiles
+# at the right and bottom edges (their windows reach into their neighbours)
+rm -rf "$WORK_FOLDER"
+mkdir -p "$WORK_FOLDER/stack"
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/stack" 250 190 4 > /dev/null || exit 1
+
+FAILED=0
+for PROGRAM in C++_Version2 C++_Version3 P_Version2 P_Version3; do
+    for ORDER in random progressive; do
+        REFERENCE="$WORK_FOLDER/$PROGRAM-$ORDER.tga"
+        "$BUILDS_PATH/${PROGRAM}_headless" --order=$ORDER --seed=42 4 "$REFERENCE" "$WORK_FOLDER"/stack/*.tga 2> /dev/null || exit 1
+
+        # The same seed, run again with the same and with other thread counts
+        for NUM_THREADS in 4 4 4 1 3 7; do
+            OUTPUT="$WORK_FOLDER/$PROGRAM-$ORDER-$NUM_THREADS.tga"
+            "$BUILDS_PATH/${PROGRAM}_headless" --order=$ORDER --seed=42 $NUM_THREADS "$OUTPUT" "$WORK_FOLDER"/stack/*.tga 2> /dev/null || exit 1
+            if ! cmp -s "$REFERENCE" "$OUTPUT"; then
+                echo "$PROGRAM --order=$ORDER --seed=42 with $NUM_THREADS threads differs from the run with 4 threads"
+                FAILED=1
+            fi
+        done
+    done
+done
+exit $FAILED
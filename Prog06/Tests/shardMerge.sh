@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Check if the correct number of arguments is provided
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <path_to_builds> <work_folder>"
+    echo "Checks that a stack focused in shards, then merged, is the stack focused by a single program"
+    exit 1
+fi
+
+# Assign arguments to variables
+BUILDS_PATH=$1
+WORK_FOLDER=$2
+
+rm -rf "$WORK_FOLDER"
+mkdir -p "$WORK_FOLDER/stack"
+"$BUILDS_PATH/makeTestStack" "$WORK_FOLDER/stack" 250 190 4 > /dev/null || exit 1
+
+FAILED=0
+# Prints a message and fails the test unless two files are identical
+same() {
+    if ! cmp -s "$1" "$2"; then
+        echo "$3"
+        FAILED=1
+    fi
+}
+
+# Runs every shard of a stack, then merges them: <num_shards> <output_path> [shard options...]
+shard_and_merge() {
+    local numShards=$1 output=$2
+    shift 2
+    for SHARD in $(seq 1 "$numShards"); do
+        "$BUILDS_PATH/focusShard" "$@" 2 "$SHARD/$numShards" "$output" "$WORK_FOLDER"/stack/*.tga 2> /dev/null || return 1
+    done
+    "$BUILDS_PATH/focusMerge" "$numShards" "$output" "${output%.tga}-depth.tga" > /dev/null
+}
+
+# Bands of every height down to a few rows, with and without blending, and on a region
+for OPTIONS in "" --blend --roi=97x61+13+120; do
+    REFERENCE="$WORK_FOLDER/reference$OPTIONS.tga"
+    "$BUILDS_PATH/C++_Version1_headless" $OPTIONS 2 "$REFERENCE" "$WORK_FOLDER"/stack/*.tga 2> /dev/null || exit 1
+    for NUM_SHARDS in 1 2 3 7; do
+        OUTPUT="$WORK_FOLDER/merged$OPTIONS-$NUM_SHARDS.tga"
+        shard_and_merge $NUM_SHARDS "$OUTPUT" $OPTIONS || exit 1
+        same "$REFERENCE" "$OUTPUT" "${OPTIONS:-The stack} in $NUM_SHARDS shards merges to another output"
+        same "$WORK_FOLDER/merged$OPTIONS-1-depth.tga" "${OUTPUT%.tga}-depth.tga" \
+             "${OPTIONS:-The stack} in $NUM_SHARDS shards merges to another depth map"
+        if compgen -G "$OUTPUT.shard-*" > /dev/null; then
+            echo "The partials of $OUTPUT were left behind"
+            FAILED=1
+        fi
+    done
+done
+
+# A missing partial stops the merge
+OUTPUT="$WORK_FOLDER/missing.tga"
+for SHARD in 1 3; do
+    "$BUILDS_PATH/focusShard" 2 "$SHARD/3" "$OUTPUT" "$WORK_FOLDER"/stack/*.tga 2> /dev/null || exit 1
+done
+if "$BUILDS_PATH/focusMerge" 3 "$OUTPUT" "$WORK_FOLDER/missing-depth.tga" > /dev/null 2>&1 || [ -e "$OUTPUT" ]; then
+    echo "Shards were merged without one of their partials"
+    FAILED=1
+fi
+exit $FAILED
@@ -0,0 +1,64 @@
+/**
+ * @file focusClient.cpp
+ * @brief Sends a job to the job server (Programs/Server) and follows its progress
+ *
+ * Usage: focusClient <socket_path> <input_folder> <output_path> [--blend] [--rle] [--roi=<w>x<h>+<x>+<y>] [--window=<n>]
+ *        focusClient <socket_path> --shutdown
+ * prints the progress on stderr, and exits with 0 once the output is
+ * written, 1 if the server reports an error, 2 if it can't be reached.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "FocusServer.h"
+
+int main(int argc, char** argv) {
+    bool shutdown = (argc == 3 && strcmp(argv[2], "--shutdown") == 0);
+    if (argc < 4 && !shutdown) {
+        fprintf(stderr, "Usage: %s <socket_path> <input_folder> <output_path> [--blend] [--rle] "
+                "[--roi=<w>x<h>+<x>+<y>] [--window=<n>]\n", argv[0]);
+        fprintf(stderr, "       %s <socket_path> --shutdown\n", argv[0]);
+        return 1;
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (const sockaddr*) &address, sizeof(address)) != 0) {
+        fprintf(stderr, "Cannot reach the server on %s\n", argv[1]);
+        return 2;
+    }
+
+    // The job in the syntax of a manifest line
+    std::string request = "SHUTDOWN";
+    if (!shutdown) {
+        request = "FOCUS";
+        for (int i = 2; i < argc; i++)
+            request += std::string(" ") + argv[i];
+    }
+    if (!sendFrame(fd, request)) {
+        fprintf(stderr, "The server on %s went away\n", argv[1]);
+        return 2;
+    }
+
+    std::string reply;
+    while (receiveFrame(fd, reply)) {
+        if (reply.compare(0, 9, "PROGRESS ") == 0) {
+            fprintf(stderr, "\r%s%%", reply.c_str() + 9);
+            continue;
+        }
+        fprintf(stderr, shutdown ? "%s\n" : "\r%s\n", reply.c_str());
+        close(fd);
+        return (reply.compare(0, 4, "DONE") == 0) ? 0 : 1;
+    }
+    fprintf(stderr, "\nThe server on %s went away\n", argv[1]);
+    return 2;
+}
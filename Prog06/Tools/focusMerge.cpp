@@ -0,0 +1,22 @@
+/**
+ * @file focusMerge.cpp
+ * @brief Assembles the partial files of a sharded run (Programs/Shard) into the output and its depth map
+ *
+ * Usage: focusMerge [--rle] [--keep] <num_shards> <output_path> <depth_map_path>
+ * reads <output_path>.shard-<k>-of-<num_shards> for every k, writes the
+ * output and the depth map (0 where the pixel comes from the first layer,
+ * 255 from the last one), then removes the partials unless --keep is given.
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include "FocusShard.h"
+
+int main(int argc, char** argv) {
+    MergeOptions options;
+    if (!parseMergeOptions(argc, argv, options))
+        return 1;
+
+    return mergeShards(options);
+}
@@ -0,0 +1,124 @@
+/**
+ * @file makeTestStack.cpp
+ * @brief Writes a synthetic focus stack, for benchmarks and PGO training runs
+ *
+ * The scene is random texture (a fixed seed, so every stack generated with
+ * the same arguments is identical) seen through a lens whose plane of focus
+ * moves across the image: layer k is sharp where the focus map equals k and
+ * increasingly box-blurred away from it.  The focus map is a diagonal ramp,
+ * so every layer contributes a band of the output.
+ *
+ * Usage: makeTestStack [--rle] [--deep] <output_dir> <width> <height> <num_layers>
+ * writes <output_dir>/layer_00.tga, layer_01.tga, ... (run-length encoded
+ * with --rle), or with --deep 12-bit gray layers layer_00.pgm, layer_01.pgm, ...
+ *
+ * @author Harry Grenier
+ * @date 12/3/2023
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "RasterImage.h"
+#include "ImageIO.h"
+
+/**
+ * @brief Box-blurs a gray plane (separable, clamped at the edges).
+ * @param src Plane to blur, width x height
+ * @param width Width of the plane
+ * @param height Height of the plane
+ * @param radius Radius of the box (0 returns a copy)
+ * @return The blurred plane
+ */
+std::vector<unsigned char> boxBlur(const std::vector<unsigned char>& src, int width, int height, int radius) {
+    std::vector<unsigned char> tmp(src.size()), dst(src.size());
+    int span = 2 * radius + 1;
+
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            int sum = 0;
+            for (int k = -radius; k <= radius; k++)
+                sum += src[row * width + std::min(std::max(col + k, 0), width - 1)];
+            tmp[row * width + col] = (unsigned char) (sum / span);
+        }
+    }
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            int sum = 0;
+            for (int k = -radius; k <= radius; k++)
+                sum += tmp[std::min(std::max(row + k, 0), height - 1) * width + col];
+            dst[row * width + col] = (unsigned char) (sum / span);
+        }
+    }
+    return dst;
+}
+
+int main(int argc, char** argv) {
+    const char* program = argv[0];
+    bool compress = false, deep = false;
+    for (; argc > 1; argv++, argc--) {
+        if (std::string(argv[1]) == "--rle")
+            compress = true;
+        else if (std::string(argv[1]) == "--deep")
+            deep = true;
+        else
+            break;
+    }
+    if (argc != 5) {
+        fprintf(stderr, "Usage: %s [--rle] [--deep] <output_dir> <width> <height> <num_layers>\n", program);
+        return 1;
+    }
+    std::string outputDir = argv[1];
+    int width = atoi(argv[2]);
+    int height = atoi(argv[3]);
+    int numLayers = atoi(argv[4]);
+    if (width <= 0 || height <= 0 || numLayers <= 0 || numLayers > 100) {
+        fprintf(stderr, "Invalid size or number of layers\n");
+        return 1;
+    }
+
+    // Random texture, from a fixed-seed linear congruential generator
+    std::vector<unsigned char> scene(width * height);
+    unsigned int state = 412;
+    for (auto& pixel : scene) {
+        state = state * 1664525u + 1013904223u;
+        pixel = (unsigned char) (state >> 24);
+    }
+
+    // The scene at every amount of blur a layer can need
+    std::vector<std::vector<unsigned char>> blurred;
+    for (int radius = 0; radius < numLayers; radius++)
+        blurred.push_back(boxBlur(scene, width, height, radius));
+
+    for (int layer = 0; layer < numLayers; layer++) {
+        RasterImage image(width, height, deep ? DEEP_GRAY_RASTER : RGBA32_RASTER);
+        unsigned char** raster2D = (unsigned char**) image.raster2D;
+        unsigned short** deepRaster2D = (unsigned short**) image.raster2D;
+        if (deep)
+            image.maxVal = 4095;
+        for (int row = 0; row < height; row++) {
+            for (int col = 0; col < width; col++) {
+                int focus = (int) ((long) (row + col) * numLayers / (width + height));
+                unsigned char gray = blurred[std::abs(layer - focus)][row * width + col];
+                if (deep) {
+                    deepRaster2D[row][col] = (unsigned short) (gray * 4095 / 255);
+                    continue;
+                }
+                raster2D[row][4 * col] = gray;
+                raster2D[row][4 * col + 1] = (unsigned char) (gray / 2 + 64);
+                raster2D[row][4 * col + 2] = (unsigned char) (255 - gray);
+                raster2D[row][4 * col + 3] = 255;
+            }
+        }
+
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "/layer_%02d.%s", layer, deep ? "pgm" : "tga");
+        if (writeImage((outputDir + fileName).c_str(), &image, compress) != kNoIOerror) {
+            fprintf(stderr, "Could not write %s%s\n", outputDir.c_str(), fileName);
+            return 1;
+        }
+    }
+    return 0;
+}